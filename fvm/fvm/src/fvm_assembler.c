@@ -21,14 +21,17 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "fvm_runtime.h" // fvma is linked with the runtime, to run routines for the evaluation directive
+
 #define ALLOC_SIZE 50 // No. bytes to allocate and reallocate memory by
-#define NO_INSTRUCTIONS 28 // No. instructions
+#define NO_INSTRUCTIONS 127 // No. instructions
 #define MAX_NO_OPERANDS 2 // Maximum operands an instruction can have
 #define NO_LEGAL_LABEL_CHARACTER_RANGES 4 // No. ranges that exist for what a legal character in a label can exist within
-#define NO_DEFAULT_LABELS 11 // Number of default labels to go in the Label Table
+#define NO_DEFAULT_LABELS 34 // Number of default labels to go in the Label Table
 #define NO_DIGIT_CHARS 16 // Nummber of characters that can represent a digit (0-9, A-Z)
 
 #define DEFAULT_OUTPUT_FILENAME "a.fb"
+#define EVALUATION_DIRECTIVE "ev" // Directive to run a routine as the program is assembled, placing the words it outputs in the ROM: ev <routine> <number of words>
 
 const char LEGAL_LABEL_CHARACTER_RANGES[NO_LEGAL_LABEL_CHARACTER_RANGES][2] = { // A legal character in an identifier/label is one that lies within one of these ranges
 	{'0', '9'},
@@ -40,7 +43,7 @@ const char LEGAL_LABEL_CHARACTER_RANGES[NO_LEGAL_LABEL_CHARACTER_RANGES][2] = {
 // List of valid instruction keywords, their numerical translation (their index in the array), and their number of operands:
 
 const struct instruction {
-	char text[3];
+	char text[4];
 	unsigned char no_operands;
 } INSTRUCTIONS[NO_INSTRUCTIONS] = {
 	[0] = {"pl", 2},
@@ -77,7 +80,129 @@ const struct instruction {
 	[25] = {"cl", 1},
 	[26] = {"rt", 0},
 
-	[27] = {"fi", 0}
+	[27] = {"fi", 0},
+
+	[28] = {"a+i", 1},
+	[29] = {"a-i", 1},
+	[30] = {"a*i", 1},
+	[31] = {"a/i", 1},
+
+	[32] = {"a&i", 1},
+	[33] = {"a|i", 1},
+	[34] = {"a^i", 1},
+	[35] = {"ali", 1},
+	[36] = {"ari", 1},
+
+	[37] = {"gti", 1},
+	[38] = {"lti", 1},
+	[39] = {"gei", 1},
+	[40] = {"lei", 1},
+	[41] = {"eqi", 1},
+	[42] = {"nei", 1},
+
+	[43] = {"sta", 1},
+	[44] = {"lda", 1},
+	[45] = {"str", 1},
+	[46] = {"ldr", 1},
+	[47] = {"stx", 0},
+	[48] = {"ldx", 0},
+
+	[49] = {"jgt", 1},
+	[50] = {"jlt", 1},
+	[51] = {"jge", 1},
+	[52] = {"jle", 1},
+	[53] = {"jeq", 1},
+	[54] = {"jne", 1},
+	[55] = {"djn", 2},
+
+	[56] = {"pu", 1},
+	[57] = {"po", 1},
+	[58] = {"pk", 1},
+
+	[59] = {"a+r", 1},
+	[60] = {"a-r", 1},
+	[61] = {"a*r", 1},
+	[62] = {"a/r", 1},
+
+	[63] = {"a&r", 1},
+	[64] = {"a|r", 1},
+	[65] = {"a^r", 1},
+	[66] = {"alr", 1},
+	[67] = {"arr", 1},
+
+	[68] = {"gtr", 1},
+	[69] = {"ltr", 1},
+	[70] = {"ger", 1},
+	[71] = {"ler", 1},
+	[72] = {"eqr", 1},
+	[73] = {"ner", 1},
+
+	[74] = {"bc", 1},
+	[75] = {"bf", 0},
+
+	[76] = {"di", 1},
+	[77] = {"do", 1},
+
+	[78] = {"v+", 0},
+	[79] = {"v-", 0},
+	[80] = {"v*", 0},
+	[81] = {"v&", 0},
+	[82] = {"v|", 0},
+	[83] = {"v^", 0},
+
+	[84] = {"ve", 0},
+	[85] = {"v<", 0},
+	[86] = {"v>", 0},
+
+	[87] = {"vs", 0},
+	[88] = {"vn", 0},
+	[89] = {"vx", 0},
+
+	[90] = {"fw", 0},
+	[91] = {"fb", 0},
+	[92] = {"cr", 0},
+
+	[93] = {"f+", 0},
+	[94] = {"f-", 0},
+	[95] = {"f*", 0},
+	[96] = {"f/", 0},
+	[97] = {"fsq", 0},
+
+	[98] = {"fgt", 0},
+	[99] = {"flt", 0},
+	[100] = {"fge", 0},
+	[101] = {"fle", 0},
+	[102] = {"feq", 0},
+	[103] = {"fne", 0},
+
+	[104] = {"itf", 0},
+	[105] = {"fti", 0},
+
+	[106] = {"a%", 0},
+
+	[107] = {"s/", 0},
+	[108] = {"s%", 0},
+	[109] = {"sr", 0},
+
+	[110] = {"sgt", 0},
+	[111] = {"slt", 0},
+	[112] = {"sge", 0},
+	[113] = {"sle", 0},
+
+	[114] = {"pc", 0},
+	[115] = {"lz", 0},
+	[116] = {"tz", 0},
+	[117] = {"rl", 0},
+	[118] = {"rr", 0},
+	[119] = {"bs", 0},
+	[120] = {"mh", 0},
+
+	[121] = {"cs", 1},
+	[122] = {"cz", 1},
+	[123] = {"mx", 0},
+	[124] = {"mn", 0},
+	[125] = {"smx", 0},
+	[126] = {"smn", 0}
 };
 
 // List of labels and their values to go in the Label Table by default:
@@ -90,6 +215,11 @@ const struct label {
 	{"mem", 0},
 	{"inp", 1},
 	{"out", 2},
+	{"dst", 4},
+	{"hsh", 5},
+	{"hsc", 6},
+	{"alg", 7},
+	{"alc", 8},
 
 	{"mch", 0},
 	{"mar", 1},
@@ -97,7 +227,27 @@ const struct label {
 	{"acc", 3},
 	{"dat", 4},
 	{"cea", 5},
-	{"csp", 6}
+	{"csp", 6},
+	{"dsp", 7},
+
+	{"r0", 8},
+	{"r1", 9},
+	{"r2", 10},
+	{"r3", 11},
+	{"r4", 12},
+	{"r5", 13},
+	{"r6", 14},
+	{"r7", 15},
+	{"r8", 16},
+	{"r9", 17},
+	{"r10", 18},
+	{"r11", 19},
+	{"r12", 20},
+	{"r13", 21},
+	{"r14", 22},
+	{"r15", 23},
+
+	{"win", 281474976710656} // Address in Main Memory that the disk window starts at
 };
 
 // Definition of tokens that the syntax can be broken down into:
@@ -111,7 +261,9 @@ struct token {
 		BINARY,
 		HEXADECIMAL,
 		OCTAL,
-		DECIMAL
+		DECIMAL,
+		FLOATING,
+		EVALUATION
 	} type;
 
 	size_t text_size, // No. bytes that the text is allocated
@@ -153,6 +305,28 @@ uint64_t convert(struct token *raw) { // Convert the text of a literal-token int
 			 value = 0, // The overall value that the literal represents (the return value of this function)
 			 multiplier = 0, // The multiplicative difference from one digit to the next (equal to the base of the number)
 			 digitMultiple = 1; // The multiple of the digit that is represented by its position in the overall number
+	double floating; // The value of a floating-point literal
+	char *end; // Where the C library stopped reading a floating-point literal
+
+	if(raw->type == FLOATING) { // Floating-point literals are read by the C library, and represented by the bits of the double
+		floating = strtod(raw->text, &end);
+
+		if(end == raw->text || end != raw->text + raw->text_length - 2) { // If it didn't read all the way up to the ']'
+			fprintf(stderr,
+					"fvma -> Line %zu: Invalid floating-point literal '%.*s'\n",
+					raw->line,
+					(int)raw->text_length - 2,
+					raw->text);
+
+			errors = true;
+
+			return 0;
+		}
+
+		memcpy(&value, &floating, sizeof(double));
+
+		return value;
+	}
 
 	switch(raw->text[raw->text_length - 1]) { // Find the multiplier (base of the number, denoted by a specifier on the end of the literal)
 		case 'b': // binary
@@ -212,11 +386,14 @@ int fvma_main(int argc, char **argv) { // Main function
 		 whitespace = false, // (Lexer) If the current char is within whitespace - used for ignoring characters
 		 rawText = false, // (Lexer) If the current char is within a literal - used for ignoring what would otherwise be tokenised
 		 label = false, // (Lexer) If the current char is within a label - used for determining the start address of the next token
+		 operand = false, // (Lexer) If the current token is an operand of the last instruction-token - used so that operands aren't checked for being instructions
 		 characterWasLegal, // (Parser) If the character currently being checked in the currently processing label-definition was a valid character for a label, or not
 		 labelWasFound, // (Parser) If the label being called upon exists in the Label Table
 		 escape; // (Parser) When processing the characters of a string literal, was an escape-sequence initiated?
 	uint64_t *output, // (Parser) Bytes to be written to rom
-			 nextValue = 0; // (Parser) the next value to be written to the output buffer
+			 nextValue = 0, // (Parser) the next value to be written to the output buffer
+			 entry, // (Parser) Address of the routine of an evaluation directive
+			 produced; // (Parser) Number of words output by the routine of an evaluation directive
 	void *allocBuff; // Buffer for memory (re)allocation, so that memory may be freed if an operation on it fails
 	size_t sourceLength = 0, // Length of source in chars (discluding \0)
 		   maxAddress = 0, // (Lexer) Address used to provide parser with the address of each token in the output
@@ -227,6 +404,7 @@ int fvma_main(int argc, char **argv) { // Main function
 		   rawTextLength = 0, // (Lexer) No. raw chars read from recently inputted literal
 		   line = 1, // Line count, for error reports
 		   operands = 0, // (Lexer) Number of operands possessed by last instruction token, so that it can be known not to check for instruction tokens if given tokens are in the places of an instruction's operands
+		   evaluation = 0, // (Lexer) Number of tokens of the last evaluation directive (including the directive itself) still to be given addresses, since only its number of words takes up any space
 		   labelTableSize = ALLOC_SIZE, // (Parser) Number of struct labels allocated to the Label Table
 		   labelTableLength = NO_DEFAULT_LABELS, // (Parser) Amount of labels stored in the Label Table
 		   outputSize = ALLOC_SIZE, // Number of uint64_ts allocated to the output buffer
@@ -234,6 +412,7 @@ int fvma_main(int argc, char **argv) { // Main function
 		   lengthBuff; // Buffer to detect if a third argument passed to the script is greater than 2 chars in length
 	char *source, *textBuff, *outputFilename; // (Lexer) Raw source code from input file; buffer for the text of the current token to be put into the sourceInstructions array; name of output file
 	FILE *f; // General-purpose file pointer; only one file is ever opened at once
+	int status = 0; // What's returned once cleaned up: 0 if the binary was written, 2 if it couldn't be, or 4 if there were errors in the source
 	struct token *sourceInstructions; // List of tokens passed from the lexer to the parser
 	struct label *labelTable; // Label Tabel, the table of labels :3
 
@@ -422,6 +601,8 @@ int fvma_main(int argc, char **argv) { // Main function
 
 				// Then! work out what on earth it is:
 
+				operand = operands; // Whether this token is one of the operands of the last instruction-token (so that it's never mistaken for an instruction itself)
+
 				if(operands) // If the number of operands remaining to collect for the last instruction-token is non-zero
 					operands--; // Decrement the number of tokens remaining that fulfill this role
 
@@ -442,13 +623,21 @@ int fvma_main(int argc, char **argv) { // Main function
 						case 'd':
 							sourceInstructions[sourceInstructionsLength - 1].type = DECIMAL;
 							break;
+						case 'f':
+							sourceInstructions[sourceInstructionsLength - 1].type = FLOATING;
+							break;
 						default: // Or if there's a letter there that isn't a specifier, report it!
 							fprintf(stderr, "fvma -> Line %zu: Unrecognised raw-data type specifier '%c'\n", line, textBuff[textBuffLength - 1]);
 							errors = true;
 					}
 				} else if(textBuff[textBuffLength - 1] == ':' || textBuff[textBuffLength - 1] == '=') { // Or is it a label definition of some kind?
 					sourceInstructions[sourceInstructionsLength - 1].type = LABEL_DEFINITION;
-				} else if(!operands) { // Or is it something else, that is possibly an instruction?
+				} else if(!operand && !strcmp(textBuff, EVALUATION_DIRECTIVE)) { // Or is it the evaluation directive?
+					sourceInstructions[sourceInstructionsLength - 1].type = EVALUATION;
+
+					operands = 2; // Its routine and number of words
+					evaluation = 3;
+				} else if(!operand) { // Or is it something else, that is possibly an instruction?
 					sourceInstructions[sourceInstructionsLength - 1].type = INSTRUCTION; // Assume that the token's an instruction
 
 					operands = MAX_NO_OPERANDS + 1;
@@ -473,6 +662,24 @@ int fvma_main(int argc, char **argv) { // Main function
 
 				if(label) { // Labels shouldn't change the address of the next token
 					label = false;
+				} else if(evaluation) { // Nor should an evaluation directive, or its routine, but its number of words should (which has to be known now, so must be a literal)
+					if(!--evaluation) {
+						switch(sourceInstructions[sourceInstructionsLength - 1].type) {
+							case BINARY:
+							case HEXADECIMAL:
+							case OCTAL:
+							case DECIMAL:
+								maxAddress += convert(&sourceInstructions[sourceInstructionsLength - 1]);
+
+								break;
+							default:
+								fprintf(stderr, "fvma -> Line %zu: Number of words to evaluate must be a whole-number literal\n", line);
+
+								errors = true;
+						}
+					}
+
+					rawTextLength = 0;
 				} else {
 			        	if(sourceInstructions[sourceInstructionsLength - 1].type == STRING) // Strings take up 1 address per character, so the address after a string should be advanced by the amount of characters in the string
 				        	maxAddress += rawTextLength;
@@ -598,6 +805,17 @@ int fvma_main(int argc, char **argv) { // Main function
 			}
 
 			sourceInstructions[i].text[--sourceInstructions[i].text_length] = '\0'; // Remove the : or = from the end of the name, so that calls to the label don't have to contain it
+
+			for(size_t j = 0; j < NO_DEFAULT_LABELS; j++) { // Default labels are found first when looking labels up, so one of the same name could never be used
+				if(!strcmp(DEFAULT_LABELS[j].text, sourceInstructions[i].text)) {
+					fprintf(stderr,
+							"fvma -> Line %zu: Label '%s' is already defined by default, so can't be defined again\n",
+							sourceInstructions[i].line,
+							sourceInstructions[i].text);
+
+					errors = true;
+				}
+			}
 		}
 	}
 
@@ -696,6 +914,51 @@ int fvma_main(int argc, char **argv) { // Main function
 					output[outputLength - 1] = sourceInstructions[i].text[j]; // Send each character of the string to the output buffer
 				}
 				
+				continue;
+			case EVALUATION: // If it's an evaluation directive, reserve its number of words in the output buffer (to be filled in once the rest of it has been generated)
+				if(i + 2 >= sourceInstructionsLength) {
+					fprintf(stderr,
+							"fvma -> Line %zu: Expected a routine and number of words after '%s'\n",
+							sourceInstructions[i].line,
+							EVALUATION_DIRECTIVE);
+
+					errors = true;
+
+					continue;
+				}
+
+				for(uint64_t j = errors ? 0 : convert(&sourceInstructions[i + 2]); j > 0; j--) { // (Unless its number of words couldn't be worked out, in which case nothing will be output anyway)
+					if(++outputLength > outputSize) { // Allocate extra space to the output buffer if necessary to accomodate it
+						outputSize += ALLOC_SIZE;
+
+						allocBuff = (void *)realloc(output, outputSize * sizeof(uint64_t));
+
+						if(allocBuff == NULL) { // If attempting to do so fails, fail
+							perror("fvma -> Could not allocate more memory to output buffer");
+
+							free(textBuff);
+
+							for(size_t k = 0; k < sourceInstructionsLength; k++)
+								free(sourceInstructions[k].text);
+
+							free(sourceInstructions);
+							free(source);
+							free(labelTable);
+							free(output);
+
+							fclose(f);
+
+							return 3;
+						}
+
+						output = (uint64_t *)allocBuff;
+					}
+
+					output[outputLength - 1] = 0;
+				}
+
+				i += 2; // Its operands have been dealt with
+
 				continue;
 			default: // If it's something else
 				if(sourceInstructions[i].type == LABEL_DEFINITION) // That's not a label definition
@@ -735,6 +998,64 @@ int fvma_main(int argc, char **argv) { // Main function
 		output[outputLength - 1] = nextValue; // Push nextValue onto the output buffer
 	}
 
+	// Run the routine of each evaluation directive on the generated binary, in order (so that routines can use what earlier ones output), and fill in its words with what it outputs:
+
+	for(size_t i = 0; i < sourceInstructionsLength && !errors; i++) {
+		if(sourceInstructions[i].type != EVALUATION)
+			continue;
+
+		if(sourceInstructions[i + 1].type == LABEL) { // Find the address of the routine
+			labelWasFound = false;
+
+			for(size_t j = 0; j < labelTableLength; j++) {
+				if(!strcmp(labelTable[j].text, sourceInstructions[i + 1].text)) {
+					entry = labelTable[j].meaning;
+					labelWasFound = true;
+					break;
+				}
+			}
+
+			if(!labelWasFound) {
+				fprintf(stderr,
+						"fvma -> Line %zu: What is '%s'? Unrecognised label\n",
+						sourceInstructions[i + 1].line,
+						sourceInstructions[i + 1].text);
+
+				errors = true;
+
+				break;
+			}
+		} else if(sourceInstructions[i + 1].type != STRING) { // Which can also be given as a literal
+			entry = convert(&sourceInstructions[i + 1]);
+		} else {
+			fprintf(stderr,
+					"fvma -> Line %zu: The routine to evaluate must be a label or address, not a string\n",
+					sourceInstructions[i + 1].line);
+
+			errors = true;
+
+			break;
+		}
+
+		if(fvmr_evaluate_routine(output, outputLength, entry, output + sourceInstructions[i].address, convert(&sourceInstructions[i + 2]), &produced)) {
+			fprintf(stderr,
+					"fvma -> Line %zu: Routine '%s' failed when evaluated\n",
+					sourceInstructions[i].line,
+					sourceInstructions[i + 1].text);
+
+			errors = true;
+		} else if(produced != convert(&sourceInstructions[i + 2])) {
+			fprintf(stderr,
+					"fvma -> Line %zu: Routine '%s' output %zu words when evaluated, but %zu were reserved for it\n",
+					sourceInstructions[i].line,
+					sourceInstructions[i + 1].text,
+					produced,
+					convert(&sourceInstructions[i + 2]));
+
+			errors = true;
+		}
+	}
+
 	// Write output to file:
 
 	fclose(f);
@@ -752,9 +1073,15 @@ int fvma_main(int argc, char **argv) { // Main function
 
 	if(errors) { // If there were errors, report it
 		fprintf(stderr, "fvma -> Something smells fishy, so output file was not overwritten with generated binary\n");
-	} else { // Otherwise, write the output buffer to the output file
-		f = fopen(outputFilename, "wb");
+
+		status = 4;
+	} else if((f = fopen(outputFilename, "wb")) == NULL) { // Otherwise, write the output buffer to the output file
+		perror("fvma -> Could not open output file");
+
+		status = 2;
+	} else {
 		fwrite(output, sizeof(uint64_t), outputLength, f);
+		fclose(f);
 	}
 
 	// Cleanup:
@@ -769,9 +1096,7 @@ int fvma_main(int argc, char **argv) { // Main function
 	free(labelTable);
 	free(output);
 
-	fclose(f);
-
-	return 0; // Done!
+	return status; // Done!
 }
 
 
@@ -0,0 +1,62 @@
+/* Fox Virtual Machine: Evaluator
+ * Copyright (C) 2024 Finn Chipp
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* A native host tool (built with `make fvme`) for evaluating programs ahead of time, at build time:
+ *
+ *     ./fvme <source.fa> <header.h> <name>
+ *
+ * assembles source (running any ev directives in it), runs the program it gives, and writes Main Memory as it is when that
+ * finishes to header, as a static const uint64_t array called name, which a C or C++ program can then #include instead of
+ * working the same values out each time it runs. Like fvmr, it's run from the directory with hardware/ in it (for the disk).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fvm_runtime.h"
+
+int fvma_main(int argc, char **argv); // From the assembler, which fvme is linked with
+
+int main(int argc, char **argv) {
+	char *binary; // Where the assembled program goes on its way to being evaluated
+	int status;
+
+	if(argc != 4) {
+		fprintf(stderr, "fvme -> Usage: %s <source.fa> <header.h> <name>\n", argv[0]);
+
+		return 1;
+	}
+
+	if((binary = (char *)malloc(strlen(argv[2]) + sizeof(".fb"))) == NULL) { // Named after the header, so that evaluating several programs at once doesn't mix them up
+		perror("fvme -> Could not allocate memory for binary's filename");
+
+		return 3;
+	}
+
+	sprintf(binary, "%s.fb", argv[2]);
+
+	remove(binary); // So that if assembling fails, an old binary isn't evaluated instead
+
+	if(!(status = fvma_main(3, (char *[]){"fvma", argv[1], binary}))) // Only a program that assembled is evaluated (fvma has already said what went wrong otherwise)
+		status = fvmr_evaluate_file(binary, argv[1], argv[2], argv[3]);
+
+	remove(binary);
+	free(binary);
+
+	return status;
+}
@@ -17,31 +17,117 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "fvm_runtime.h"
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__) // Native Linux builds watch peripherals with epoll, hold back SIGPIPE when writing to them, and queue disk requests with io_uring, or a pool of threads where the kernel doesn't have it (Emscripten, and anywhere else, poll every peripheral on each wait, and carry out disk requests as they're queued, unless built with threads)
+#define FVM_EPOLL
+#define FVM_SIGPIPE // (Emscripten has no other processes to hang up on a peripheral, so never raises SIGPIPE)
+#define FVM_DISK_THREADS
+#if !defined(FVM_NO_IO_URING) && defined(__has_include) // (Building with FVM_NO_IO_URING always uses the threads)
+#if __has_include(<linux/io_uring.h>)
+#define FVM_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#include <sys/epoll.h>
+#include <pthread.h>
+#include <signal.h>
+#elif defined(__EMSCRIPTEN_PTHREADS__) // Emscripten builds with -pthread can queue disk requests with a pool of threads too
+#define FVM_DISK_THREADS
+#include <pthread.h>
+#endif
 
 #define FVM_ROM "hardware/rom" // The ROM file
 #define FVM_DISK "hardware/disk" // The Disk file
-#define NO_FILES 4 // Number of files/memory channels
-#define NO_REGISTERS 7 // Number of registers
-#define NO_INSTRUCTIONS 27 // Number of instructions
+#define NO_FILES 5 // Number of files/memory channels
+#define NO_CHANNELS 16 // Number of memory channels that devices can be registered on
+#define NO_ENDPOINTS 16 // Number of endpoints on each of Input and Output that devices can be registered on
+#define NO_REGISTERS 24 // Number of registers
+#define NO_INSTRUCTIONS 127 // Number of instructions (including 27, fi, which is handled by the execution loop itself)
 
 #define ALLOC_SIZE 50 // Size to reallocate/allocate memory
+#define VECTOR_LANES 4 // Number of words operated on at once by vector instructions (4 x 64 bits, for AVX2 on x86-64, or two 128-bit operations with SSE or WASM SIMD)
+#define MAX_NUMBER_BASE 36 // Largest base numbers can be written/read in (using 0-9 then a-z as digits)
+#define DATA_STACK_SIZE 1024 // Number of words to preallocate (and grow by) for the Data Stack
+#define HASH_MAP_SIZE 64 // Number of slots a hash map starts off with (always a power of two)
+#define NO_SIZE_CLASSES 48 // Number of size classes the allocator has (blocks of 2^0 up to 2^47 words)
+#define INPUT_BUFFER_SIZE 65536 // Number of bytes read from stdin at once
+#define DISK_BLOCK_SIZE 4096 // Number of bytes read from the disk at once when it isn't being read sequentially
+#define DISK_BUFFER_SIZE (1 << 20) // Most bytes read from the disk at once (when it's being read sequentially), or written to it at once
+#define DISK_QUEUE_SIZE 16 // Most disk requests (reading ahead, and writes) that can be queued at once
+#define DISK_WRITE_BATCH 4 // Number of writes queued before they're submitted to an io_uring together (unless something's waited for first)
+#define DISK_THREADS 2 // Number of threads carrying out disk requests, where there's no io_uring
+#define DISK_WINDOW_BASE ((uint64_t)1 << 48) // Address in Main Memory that the disk window starts at (far above anything Main Memory could be allocated for)
+#define ALLOCATOR_TRIM_SIZE 4096 // Number of words that must be unused at the end of Main Memory before the allocator gives them back to the host
+#define NO_PERIPHERALS 8 // Number of host file descriptors that can be open as peripherals at once
+#define PERIPHERAL_ENDPOINT 8 // Endpoint (on both Input and Output) of the first peripheral (the rest follow it, up to NO_ENDPOINTS)
+#define MAX_PATH_LENGTH 4096 // Longest path (including its terminating 0) that a peripheral can be opened from
+
+#ifdef __GNUC__ // GCC and Clang (including Emscripten) can lower vector types to whichever SIMD instructions the target has
+typedef uint64_t fvm_vector __attribute__((vector_size(VECTOR_LANES * sizeof(uint64_t)))); // VECTOR_LANES words, operated on as a single value
+
+#define VECTOR_LOOP(operation) /* Apply operation to x and y, as many words at a time as possible, leaving i at the first word that is left over */ \
+	for(; i + VECTOR_LANES <= n; i += VECTOR_LANES) { \
+		fvm_vector x, y; \
+		\
+		memcpy(&x, a + i, sizeof(fvm_vector)); \
+		memcpy(&y, b + i, sizeof(fvm_vector)); \
+		\
+		x = (fvm_vector)(operation); \
+		\
+		memcpy(d + i, &x, sizeof(fvm_vector)); \
+	}
+#else // Otherwise, everything is done by the scalar loops
+#define VECTOR_LOOP(operation)
+#endif
+
+#define VECTOR_KERNEL(name, operation) /* Define a function that sets d[i] = operation on x = a[i] and y = b[i] for the n words given */ \
+	void name(uint64_t *d, const uint64_t *a, const uint64_t *b, uint64_t n) { \
+		uint64_t i = 0; \
+		\
+		VECTOR_LOOP(operation) \
+		\
+		for(; i < n; i++) { \
+			uint64_t x = a[i], y = b[i]; \
+			\
+			d[i] = (uint64_t)(operation); \
+		} \
+	}
 
 void *alloc_buff; // Buffer for memory allocation
-FILE *disk; // File pointer to disk file at boot
+uint64_t number_base = 10; // Base that numbers are written and read in through the number conversion endpoint (2)
+
+const char NUMBER_DIGITS[MAX_NUMBER_BASE] = "0123456789abcdefghijklmnopqrstuvwxyz"; // Digits for writing/reading numbers in any base up to MAX_NUMBER_BASE
 
 enum fvm_file_no { // Files' designated numbers
 	MEM = 0,
 	INP = 1,
 	OUT = 2,
-	CST = 3
+	CST = 3,
+	DST = 4,
+	HSH = 5, // Devices from here on aren't stored as files
+	HSC = 6,
+	ALG = 7,
+	ALC = 8
 };
 
-struct fvm_file {
-	uint64_t *self,
-			 size,
-			 length;
-} files[NO_FILES]; // files/memory channels (only MEM and CST are actually stored like this)
+struct fvm_file files[NO_FILES]; // files/memory channels (only MEM, CST and DST are actually stored like this)
 
 enum fvm_register { // Registers' designated numbers
 	MCH = 0,
@@ -50,7 +136,9 @@ enum fvm_register { // Registers' designated numbers
 	ACC = 3,
 	DAT = 4,
 	CEA = 5,
-	CSP = 6
+	CSP = 6,
+	DSP = 7,
+	R0 = 8 // R0 to R15 follow on from here
 };
 
 uint64_t fvm_registers[NO_REGISTERS]; // All the registers
@@ -62,7 +150,24 @@ const char *REGISTER_NAMES[NO_REGISTERS] = { // Register names for traceback
 	"ACC (Accumulator)              ",
 	"DAT (Data)                     ",
 	"CEA (Current Execution Address)",
-	"CSP (Callstack Pointer)        "
+	"CSP (Callstack Pointer)        ",
+	"DSP (Data Stack Pointer)       ",
+	"R0 (General Purpose 0)         ",
+	"R1 (General Purpose 1)         ",
+	"R2 (General Purpose 2)         ",
+	"R3 (General Purpose 3)         ",
+	"R4 (General Purpose 4)         ",
+	"R5 (General Purpose 5)         ",
+	"R6 (General Purpose 6)         ",
+	"R7 (General Purpose 7)         ",
+	"R8 (General Purpose 8)         ",
+	"R9 (General Purpose 9)         ",
+	"R10 (General Purpose 10)       ",
+	"R11 (General Purpose 11)       ",
+	"R12 (General Purpose 12)       ",
+	"R13 (General Purpose 13)       ",
+	"R14 (General Purpose 14)       ",
+	"R15 (General Purpose 15)       "
 };
 
 void traceback(void) { // Traceback (error report)
@@ -91,6 +196,18 @@ void traceback(void) { // Traceback (error report)
 				files[CST].length - i - 1 == fvm_registers[CSP] ? "\t<- CSP" : "");
 	}
 
+	fprintf(stderr,
+			"\t---Data Stack---\n"
+			"\tAddress\tValue\n");
+
+	for(uint64_t i = 0; i < fvm_registers[DSP] && i < files[DST].size; i++) { // Display the content of the Data Stack, top first
+		fprintf(stderr,
+				"\t%zu\t%zu%s\n",
+				fvm_registers[DSP] - i - 1,
+				files[DST].self[fvm_registers[DSP] - i - 1],
+				!i ? "\t<- DSP - 1" : "");
+	}
+
 	fprintf(stderr,
 			"\t---Main Memory---\n"
 			"\tAddress\tValue\n");
@@ -155,458 +272,4191 @@ _Bool move(void) { // mv <register> <register>
 	return 0;
 }
 
-_Bool store(void) { // st <mdr> at <mar> in <mch>
-//    printf("store %zu at %zu in %zu\n", fvm_registers[MDR], fvm_registers[MAR], fvm_registers[MCH]);
+// Stored memory channels:
 
-    switch(fvm_registers[MCH]) { // Depending on the Memory Channel, write in a different way
-        case MEM: // For Main Memory:
-            if(fvm_registers[MAR] + 1 > files[MEM].length) { // If the address is bigger than what's used
-                files[MEM].length = fvm_registers[MAR] + 1;
+_Bool channel_stored(uint64_t channel) { // Whether a memory channel is stored as a file (as opposed to being a device), so that it can be operated on as a block
+	return channel == MEM || channel == CST || channel == DST;
+}
+
+// Input, read from stdin through a buffer (or from a file mapped in place of it), so that guest reads don't each go through the C library:
+
+enum fvm_input_status { // What happened the last time input was read, or a peripheral was read or written (as given by INP endpoint 5)
+	INPUT_READ = 0, // Everything asked for was read (or written)
+	INPUT_END = 1, // The input ended
+	INPUT_WAITING = 2, // Not everything asked for was ready, and reading (or writing) is non-blocking
+	INPUT_INVALID = 3 // A number was asked for, but what was read wasn't one (it had no digits, or was too big for a word)
+};
 
-                if(files[MEM].length > files[MEM].size) { // If it's bigger than what's allocated
-                    files[MEM].size = files[MEM].length;
+struct fvm_input {
+	uint8_t *buffer; // Bytes read from stdin (or the whole of the file mapped in place of it)
+	uint64_t position, // Index of the next byte to be read from the buffer
+			 length, // Number of bytes in the buffer
+			 status; // What happened the last time input was read
+	_Bool mapped, // Whether the buffer is a mapped file (and so is all of the input)
+		  nonblocking; // Whether reading when no input is ready gives INPUT_WAITING instead of waiting for some
+} input;
 
-                    if((alloc_buff = (void *)realloc(files[MEM].self, files[MEM].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate Main Memory more space to accomodate the write
-                        perror("fvmr -> Failure accessing memory at specified address");
+char *input_path; // File to map in place of stdin (NULL to read stdin itself)
 
-                        return 1;
-                    }
+void fvmr_input_file(const char *path) { // Have runs take their input from the file at path instead of stdin (or from stdin again if path is NULL), for batch jobs
+	free(input_path);
 
-                    files[MEM].self = (uint64_t *)alloc_buff;
-                }
-            }
+	if(path == NULL)
+		input_path = NULL;
+	else if((input_path = strdup(path)) == NULL)
+		perror("fvmr -> Could not allocate memory for input file's path");
+}
 
-            files[MEM].self[fvm_registers[MAR]] = fvm_registers[MDR]; // Store MDR at address MAR in Main Memory
+_Bool input_open(void) { // Set up the buffer (or map the input file), with nothing read yet
+	int fd;
+	struct stat info;
 
-            return 0;
-        case INP: // For Input:
-            switch(fvm_registers[MAR]) { // Write to input in a different place depending on MAR
-                case 0: // For Standard I/O
-                    fprintf(stdin, "%c", (uint8_t)fvm_registers[MDR]); // Write the lowest byte to stdin
+	input = (struct fvm_input){.status = INPUT_READ, .mapped = input_path != NULL};
 
-                    return 0;
-                case 1: // For disk:
-                    fseek(disk, fvm_registers[MDR], SEEK_SET); // Set the offset from the beginning of the disk to MDR
+	if(!input.mapped) {
+		if((input.buffer = (uint8_t *)malloc(INPUT_BUFFER_SIZE)) == NULL) {
+			perror("fvmr -> Could not allocate memory for input buffer");
 
-                    return 0;
-                case 3: // For screen buffer:
-                default: // For peripheral fd:
-                    fprintf(stderr, "fvmr -> Warning, writing to address on MCH 1 that is currently unimplemented\n");
+			return 1;
+		}
 
-                    return 0;
-            }
-        case OUT: // For Output:
-            switch(fvm_registers[MAR]) { // Write to output in a different place depending on MAR
-                case 0: // For Standard I/O
-                    fprintf(stdout, "%c", (uint8_t)fvm_registers[MDR]); // Write the lowest byte to stdout
+		return 0;
+	}
 
-                    return 0;
-                case 1: // For disk:
-                    fwrite(&fvm_registers[MDR], sizeof(uint8_t), 1, disk); // Write the lowest byte to disk
+	if((fd = open(input_path, O_RDONLY)) < 0 || fstat(fd, &info)) {
+		perror("fvmr -> Could not access input file");
 
-                    return 0;
-                case 3: // For screen buffer:
-                default: // For peripheral fd:
-                    fprintf(stderr, "fvmr -> Warning, writing to address on MCH 1 that is currently unimplemented\n");
+		if(fd >= 0)
+			close(fd);
 
-                    return 0;
-            }
-        case CST: // For Callstack
-            if(fvm_registers[MAR] + 1 > files[CST].size) { // If MAR is an address not currently in the allocated memory's range
-                files[CST].size = fvm_registers[MAR] + 1;
+		return 1;
+	}
 
-                if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate the callstack to accomodate it
-                    perror("fvmr -> Failure to reallocate memory for Callstack to perform write to custom address thereupon");
+	if(info.st_size && (input.buffer = (uint8_t *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) { // (An empty file can't be mapped, but doesn't need to be)
+		perror("fvmr -> Failure mapping input file");
 
-                    return 1;
-                }
+		close(fd);
 
-                files[CST].self = (uint64_t *)alloc_buff;
-            }
+		return 1;
+	}
 
-            files[CST].self[fvm_registers[MAR]] = fvm_registers[MDR]; // Write MDR to address MAR in CST
+	input.length = info.st_size;
 
-            return 0;
-        default: // For an any other given Memory Channel:
-            fprintf(stderr, "fvmr -> Attempted write to unknown MCH '%zu'\n", fvm_registers[MCH]);
+	close(fd); // The mapping stays after the file is closed
 
-            return 1;
-    }
+	return 0;
 }
 
-_Bool load(void) { // ld to <mdr> from <mar> in <mch>
-//    printf("load %zu in %zu\n", fvm_registers[MAR], fvm_registers[MCH]);
+void input_close(void) { // Free the buffer (or unmap the input file)
+	if(!input.mapped)
+		free(input.buffer);
+	else if(input.length)
+		munmap(input.buffer, input.length);
 
-    switch(fvm_registers[MCH]) { // Load in a different way depending on MCH
-        case MEM: // For Main Memory:
-            if(fvm_registers[MAR] + 1 > files[MEM].length) { // If the address to load from is outside the bounds currently allocated
-                files[MEM].length = fvm_registers[MAR] + 1; // Resize the memory known
+	input = (struct fvm_input){0};
+}
 
-                if(files[MEM].length > files[MEM].size) { // If a reallocation needs to be done in accordance with the new size
-                    files[MEM].size = files[MEM].length;
+void input_refill(void) { // Refill the empty buffer from stdin, setting input.status if there's nothing to refill it with
+	ssize_t read_bytes;
 
-                    if((alloc_buff = (void *)realloc(files[MEM].self, files[MEM].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate Main Memory
-                        perror("fvmr -> Failure accessing memory at specified address");
+	if(input.mapped) { // All of a mapped file is already in the buffer
+		input.status = INPUT_END;
 
-                        return 1;
-                    }
+		return;
+	}
 
-                    files[MEM].self = (uint64_t *)alloc_buff;
-                }
-            }
+	fflush(stdout); // So that anything asking for the input is seen before it's waited for
 
-            fvm_registers[MDR] = files[MEM].self[fvm_registers[MAR]]; // Place the value from Main Memory at MAR into MDR
+	if(input.nonblocking && poll(&(struct pollfd){.fd = STDIN_FILENO, .events = POLLIN}, 1, 0) == 0) { // If it mustn't wait, and no input is ready
+		input.status = INPUT_WAITING;
 
-            return 0;
-        case INP: // For Input:
-            switch(fvm_registers[MAR]) { // Depending on where to input from (indicated in MAR)
-                case 0: // For Standard I/O:
-                    fvm_registers[MDR] = fgetc(stdin); // Place a byte from stdin into MDR
+		return;
+	}
 
-                    return 0;
-                case 1: // For Secondary Storage:
-                    fvm_registers[MDR] = ftell(disk); // Set MDR to current offset from beginning of disk (in bytes)
+	while((read_bytes = read(STDIN_FILENO, input.buffer, INPUT_BUFFER_SIZE)) < 0 && errno == EINTR); // As much as is ready, in one go
 
-                    return 0;
-                case 3: // For Screen Buffer:
-                default: // For Peripheral fd:
-                    fprintf(stderr, "fvmr -> Warning, reading from address on MCH 1 that is currently unimplemented\n");
+	if(read_bytes < 0) // Failing to read is treated as the input ending
+		perror("fvmr -> Failure reading from stdin");
 
-                    return 0;
-            }
-        case OUT: // For Output:
-            switch(fvm_registers[MAR]) { // Depending on MAR load from a different output source:
-                case 0: // For Standard I/O:
-                    fvm_registers[MDR] = fgetc(stdout); // Retrieve one byte from stdout into MDR
+	input.position = 0;
+	input.length = read_bytes > 0 ? read_bytes : 0;
 
-                    return 0;
-                case 1: // For Secondary Storage:
-                    fread(&fvm_registers[MDR], sizeof(uint8_t), 1, disk); // Read one byte from the disk into MDR
+	if(!input.length)
+		input.status = INPUT_END;
+}
 
-                    return 0;
-                case 3: // For Screen Buffer:
-                default: // For Peripheral fd:
-                    fprintf(stderr, "fvmr -> Warning, reading from address on MCH 1 that is currently unimplemented\n");
+uint64_t input_read_bytes(uint8_t *bytes, uint64_t count) { // Read up to count bytes of input into bytes, returning the number actually read (fewer if the input ends, or isn't ready and reading is non-blocking)
+	uint64_t done = 0, n;
 
-                    return 0;
-            }
-        case CST: // For Callstack:
-            if(fvm_registers[MAR] + 1 > files[CST].size) { // If the address to read from is outside of the allocated size for the Callstack
-                files[CST].size = fvm_registers[MAR] + 1;
+	input.status = INPUT_READ;
 
-                if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Try to reallocate the Callstack's memory to retrieve the address
-                    perror("fvmr -> Failure to reallocate memory for Callstack to perform read from custom address thereupon");
+	while(done < count) {
+		if(input.position == input.length) { // If the buffer's empty, refill it
+			input_refill();
 
-                    return 1;
-                }
+			if(input.status != INPUT_READ)
+				break;
+		}
 
-                files[CST].self = (uint64_t *)alloc_buff;
-            }
+		n = count - done < input.length - input.position ? count - done : input.length - input.position; // As much as is wanted, or is in the buffer
 
-            fvm_registers[MDR] = files[CST].self[fvm_registers[MAR]]; // Place the value at MAR on the Callstack into MDR
+		memcpy(bytes + done, input.buffer + input.position, n);
 
-            return 0;
-        default: // For an unrecognised MCH:
-            fprintf(stderr, "fvmr -> Attempted read from unknown MCH '%zu'\n", fvm_registers[MCH]);
+		input.position += n;
+		done += n;
+	}
 
-            return 1;
-    }
+	return done;
 }
 
-_Bool jump(void) { // jm <address>
-    fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+int input_getc(void) { // Read a byte of input, or EOF if there isn't one (with input.status saying why)
+	uint8_t byte;
 
-    return 0;
+	return input_read_bytes(&byte, 1) ? byte : EOF;
 }
 
-_Bool jump_if_set(void) { // js <address>
-    if(fvm_registers[ACC]) // If ACC is non-zero:
-        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
-    else
-        fvm_registers[CEA]++; // Otherwise, make sure to not treat the supplied address as an instruction, by skipping over it
+// Disk, read and written through a buffer, which reads further ahead the longer the disk is read sequentially, and collects writes to make them in batches. Reading ahead and writing are queued as requests, carried out in the background by io_uring or a pool of threads where the build has them (or straight away where it doesn't), so that the program only waits for the disk when what it wants hasn't been read yet:
+
+struct fvm_disk {
+	int fd, // File descriptor of the disk file
+		ahead_request; // Request reading ahead into spare (-1 if there isn't one)
+	uint8_t *buffer, // DISK_BUFFER_SIZE bytes, holding the disk from start
+			*spare; // DISK_BUFFER_SIZE bytes to read ahead into, which are swapped with buffer once the program catches up (NULL until they're first needed)
+	uint64_t offset, // Offset from the beginning of the disk that the next byte is read from or written to
+			 start, // Offset of the first byte in the buffer
+			 length, // Number of bytes in the buffer
+			 dirty_start, // Range of the buffer that's been written to since it was last flushed (empty if they're the same)
+			 dirty_end,
+			 ahead, // Number of bytes to read next time the buffer runs out
+			 ahead_offset, // Range being read ahead into spare
+			 ahead_size;
+} disk = {.fd = -1, .ahead_request = -1}; // (fd is -1 whenever the disk isn't open)
+
+enum fvm_disk_request_state {
+	REQUEST_FREE, // The request's slot can be used
+	REQUEST_QUEUED, // Waiting to be carried out
+	REQUEST_RUNNING, // Being carried out by a thread
+	REQUEST_DONE // Carried out, with result set
+};
 
-    return 0;
-}
+struct fvm_disk_request {
+	uint8_t *buffer; // Bytes to read into, or write from (which are freed once they've been written)
+	uint64_t offset, // Offset of the disk to read or write them at
+			 size, // Number of bytes to read or write
+			 sequence; // When it was queued (so that the oldest can be found)
+	ssize_t result; // Number of bytes read or written (or -errno if that failed)
+	_Bool write;
+	enum fvm_disk_request_state state;
+};
 
-_Bool jump_if_clear(void) { // jc <address>
-    if(!fvm_registers[ACC]) // If ACC is zero:
-        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
-    else
-        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+enum fvm_disk_backend {
+	BACKEND_SYNC, // Requests are carried out as they're queued
+	BACKEND_THREADS, // Requests are carried out by a pool of threads
+	BACKEND_IO_URING // Requests are submitted to the kernel through an io_uring
+};
 
-    return 0;
+struct fvm_disk_queue {
+	struct fvm_disk_request requests[DISK_QUEUE_SIZE];
+	uint64_t sequence; // Sequence of the next request to be queued
+	enum fvm_disk_backend backend; // What's carrying out requests (chosen each time the disk is opened)
+#ifdef FVM_DISK_THREADS
+	pthread_t threads[DISK_THREADS];
+	pthread_mutex_t lock; // Held while touching the state of any request, when there are threads
+	pthread_cond_t changed; // Signalled whenever a request is queued or done, or the threads should stop
+	unsigned started; // Number of threads running
+	_Bool stop; // Whether the threads should finish
+#endif
+#ifdef FVM_IO_URING
+	int ring; // File descriptor of the io_uring
+	unsigned *sq_tail, *sq_mask, *sq_array, *cq_head, *cq_tail, *cq_mask, // Parts of its rings, as mapped
+			 unsubmitted; // Number of requests put in the submission ring that the kernel hasn't been told about yet
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *rings, *sqes_mapping;
+	size_t rings_size, sqes_size;
+#endif
+} disk_queue
+#ifdef FVM_DISK_THREADS
+	= {.lock = PTHREAD_MUTEX_INITIALIZER, .changed = PTHREAD_COND_INITIALIZER}
+#endif
+;
+
+void disk_queue_lock(void) { // Hold the lock on the queue, if there are threads that could be touching it
+#ifdef FVM_DISK_THREADS
+	if(disk_queue.backend == BACKEND_THREADS)
+		pthread_mutex_lock(&disk_queue.lock);
+#endif
 }
 
-_Bool accumulator_add(void) { // a+
-//    printf("acc += %zu\n", fvm_registers[DAT]);
+void disk_queue_unlock(void) {
+#ifdef FVM_DISK_THREADS
+	if(disk_queue.backend == BACKEND_THREADS)
+		pthread_mutex_unlock(&disk_queue.lock);
+#endif
+}
 
-    fvm_registers[ACC] += fvm_registers[DAT]; // ACC += DAT
+ssize_t disk_transfer(_Bool write, uint8_t *buffer, uint64_t size, uint64_t offset) { // Read or write size bytes at offset of the disk, in as many goes as it takes, giving the number done (fewer if reading reaches the end of the disk), or -errno if it fails
+	uint64_t done = 0;
+	ssize_t n;
 
-    return 0;
-}
+	while(done < size) {
+		if((n = write ? pwrite(disk.fd, buffer + done, size - done, offset + done) : pread(disk.fd, buffer + done, size - done, offset + done)) < 0) {
+			if(errno == EINTR)
+				continue;
 
-_Bool accumulator_sub(void) { // a-
-    fvm_registers[ACC] -= fvm_registers[DAT]; // ACC -= DAT
+			return -errno;
+		}
 
-    return 0;
-}
+		if(!n)
+			break;
 
-_Bool accumulator_not(void) { // a!
-    fvm_registers[ACC] = ~fvm_registers[ACC]; // Invert bits of ACC
+		done += n;
+	}
 
-    return 0;
+	return done;
 }
 
+#ifdef FVM_DISK_THREADS
+void *disk_queue_thread(void *unused) { // Carry out the oldest queued request, whenever there is one, until told to stop
+	struct fvm_disk_request *request;
+	ssize_t result;
 
-_Bool accumulator_increment(void) { // ai
-    fvm_registers[ACC]++; // ACC += 1
+	(void)unused;
 
-    return 0;
-}
+	pthread_mutex_lock(&disk_queue.lock);
 
+	for(;;) {
+		request = NULL;
 
-_Bool accumulator_decrement(void) { // ad
-    fvm_registers[ACC]--; // ACC -= 1
+		for(uint64_t i = 0; i < DISK_QUEUE_SIZE; i++)
+			if(disk_queue.requests[i].state == REQUEST_QUEUED && (request == NULL || disk_queue.requests[i].sequence < request->sequence))
+				request = &disk_queue.requests[i];
 
-    return 0;
-}
+		if(request == NULL) {
+			if(disk_queue.stop)
+				break;
 
+			pthread_cond_wait(&disk_queue.changed, &disk_queue.lock);
 
-_Bool accumulator_mul(void) { // a*
-    fvm_registers[ACC] *= fvm_registers[DAT]; // ACC *= DAT
+			continue;
+		}
 
-    return 0;
-}
+		request->state = REQUEST_RUNNING;
 
+		pthread_mutex_unlock(&disk_queue.lock); // (Nothing else touches the request until it's done)
 
-_Bool accumulator_div(void) { // a/
-    fvm_registers[ACC] /= fvm_registers[DAT]; // ACC /= DAT
+		result = disk_transfer(request->write, request->buffer, request->size, request->offset);
 
-    return 0;
-}
+		pthread_mutex_lock(&disk_queue.lock);
 
+		request->result = result;
+		request->state = REQUEST_DONE;
 
-_Bool accumulator_and(void) { // a&
-    fvm_registers[ACC] &= fvm_registers[DAT]; // ACC = Logical AND bits of ACC with DAT
+		pthread_cond_broadcast(&disk_queue.changed);
+	}
 
-    return 0;
+	pthread_mutex_unlock(&disk_queue.lock);
+
+	return NULL;
 }
+#endif
 
-_Bool accumulator_or(void) { // a|
-    fvm_registers[ACC] |= fvm_registers[DAT]; // ACC = Logical OR bits of ACC with DAT
+#ifdef FVM_IO_URING
+_Bool disk_ring_setup(void) { // Set up an io_uring (using the system calls directly), returning whether it can't be (if the kernel doesn't have it, or is older than IORING_OP_READ/WRITE, which came with IORING_FEAT_RW_CUR_POS in Linux 5.6)
+	struct io_uring_params params;
+	uint8_t *rings;
+	size_t cq_size;
 
-    return 0;
-}
+	memset(&params, 0, sizeof(params));
 
+	if((disk_queue.ring = syscall(__NR_io_uring_setup, DISK_QUEUE_SIZE, &params)) < 0)
+		return 1;
 
-_Bool accumulator_xor(void) { // a^
-    fvm_registers[ACC] ^= fvm_registers[DAT]; // ACC = Logical XOR bits of ACC with DAT
+	if(!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+		close(disk_queue.ring);
 
-    return 0;
-}
+		return 1;
+	}
 
+	disk_queue.rings_size = params.sq_off.array + params.sq_entries * sizeof(unsigned); // Both rings are mapped at once
+	cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
 
-_Bool accumulator_lsh(void) { // al
-    fvm_registers[ACC] <<= fvm_registers[DAT]; // Left shift bits of ACC by DAT amount
+	if(cq_size > disk_queue.rings_size)
+		disk_queue.rings_size = cq_size;
 
-    return 0;
-}
+	disk_queue.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
 
+	if((disk_queue.rings = mmap(NULL, disk_queue.rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, disk_queue.ring, IORING_OFF_SQ_RING)) == MAP_FAILED) {
+		close(disk_queue.ring);
 
-_Bool accumulator_rsh(void) { // ar
-    fvm_registers[ACC] >>= fvm_registers[DAT]; // Right shift bits of ACC by DAT amount
+		return 1;
+	}
 
-    return 0;
-}
+	if((disk_queue.sqes_mapping = mmap(NULL, disk_queue.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, disk_queue.ring, IORING_OFF_SQES)) == MAP_FAILED) {
+		munmap(disk_queue.rings, disk_queue.rings_size);
+		close(disk_queue.ring);
 
+		return 1;
+	}
 
-_Bool accumulator_gt(void) { // gt
-    fvm_registers[ACC] = fvm_registers[ACC] > fvm_registers[DAT]; // ACC = 1 if ACC > DAT otherwise ACC = 0
+	rings = (uint8_t *)disk_queue.rings;
 
-    return 0;
+	disk_queue.sq_tail = (unsigned *)(rings + params.sq_off.tail);
+	disk_queue.sq_mask = (unsigned *)(rings + params.sq_off.ring_mask);
+	disk_queue.sq_array = (unsigned *)(rings + params.sq_off.array);
+	disk_queue.cq_head = (unsigned *)(rings + params.cq_off.head);
+	disk_queue.cq_tail = (unsigned *)(rings + params.cq_off.tail);
+	disk_queue.cq_mask = (unsigned *)(rings + params.cq_off.ring_mask);
+	disk_queue.cqes = (struct io_uring_cqe *)(rings + params.cq_off.cqes);
+	disk_queue.sqes = (struct io_uring_sqe *)disk_queue.sqes_mapping;
+	disk_queue.unsubmitted = 0;
+
+	return 0;
 }
 
+void disk_ring_queue(uint64_t index) { // Put the request at index in the submission ring (to be submitted the next time the kernel is entered)
+	struct fvm_disk_request *request = &disk_queue.requests[index];
+	unsigned tail = *disk_queue.sq_tail, slot = tail & *disk_queue.sq_mask; // (The ring has a slot for every request, so there's always room)
+	struct io_uring_sqe *sqe = &disk_queue.sqes[slot];
 
-_Bool accumulator_lt(void) { // lt
-    fvm_registers[ACC] = fvm_registers[ACC] < fvm_registers[DAT]; // ACC = 1 if ACC < DAT otherwise ACC = 0
+	memset(sqe, 0, sizeof(*sqe));
 
-    return 0;
-}
+	sqe->opcode = request->write ? IORING_OP_WRITE : IORING_OP_READ;
+	sqe->fd = disk.fd;
+	sqe->addr = (uint64_t)(uintptr_t)request->buffer;
+	sqe->len = request->size;
+	sqe->off = request->offset;
+	sqe->user_data = index;
 
-_Bool accumulator_ge(void) { // ge
-    fvm_registers[ACC] = fvm_registers[ACC] >= fvm_registers[DAT]; // ACC = 1 if ACC >= DAT otherwise ACC = 0
+	disk_queue.sq_array[slot] = slot;
 
-    return 0;
+	__atomic_store_n(disk_queue.sq_tail, tail + 1, __ATOMIC_RELEASE); // Only once the entry is filled in can the kernel see it
+
+	disk_queue.unsubmitted++;
 }
 
+_Bool disk_ring_enter(_Bool wait) { // Submit everything in the submission ring (waiting for at least one request to be done, if wait), then mark every request that's done as such, returning whether the kernel couldn't be entered
+	unsigned head, tail;
+	int submitted;
 
-_Bool accumulator_le(void) { // le
-    fvm_registers[ACC] = fvm_registers[ACC] <= fvm_registers[DAT]; // ACC = 1 if ACC <= DAT otherwise ACC = 0
+	while((submitted = syscall(__NR_io_uring_enter, disk_queue.ring, disk_queue.unsubmitted, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0)) < 0)
+		if(errno != EINTR) {
+			perror("fvmr -> Failure submitting disk requests");
 
-    return 0;
-}
+			return 1;
+		}
 
-_Bool accumulator_eq(void) { // eq
-    fvm_registers[ACC] = fvm_registers[ACC] == fvm_registers[DAT]; // ACC = 1 if ACC == DAT otherwise ACC = 0
+	disk_queue.unsubmitted -= submitted;
 
-    return 0;
-}
+	head = *disk_queue.cq_head;
+	tail = __atomic_load_n(disk_queue.cq_tail, __ATOMIC_ACQUIRE);
 
+	for(; head != tail; head++) {
+		struct io_uring_cqe *cqe = &disk_queue.cqes[head & *disk_queue.cq_mask];
 
-_Bool accumulator_ne(void) { // ne
-    fvm_registers[ACC] = fvm_registers[ACC] != fvm_registers[DAT]; // ACC = 1 if ACC != DAT otherwise ACC = 0
+		disk_queue.requests[cqe->user_data].result = cqe->res;
+		disk_queue.requests[cqe->user_data].state = REQUEST_DONE;
+	}
 
-    return 0;
+	__atomic_store_n(disk_queue.cq_head, head, __ATOMIC_RELEASE); // Give the completions' slots back to the kernel
+
+	return 0;
 }
+#endif
 
-_Bool call_address(void) { // cl
-    if(++files[CST].length > files[CST].size) { // If the callstack needs reallocating to include the address of this call
-        files[CST].size += ALLOC_SIZE;
+void disk_queue_start(void) { // Choose what carries out requests: io_uring if the kernel has it, otherwise a pool of threads, otherwise nothing (carrying each out as it's queued)
+	disk_queue.backend = BACKEND_SYNC;
+	disk_queue.sequence = 0;
 
-        if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Try to allocate it more space
-            perror("fvmr -> Failure reallocating memory for Callstack");
+#ifdef FVM_IO_URING
+	if(!disk_ring_setup()) {
+		disk_queue.backend = BACKEND_IO_URING;
 
-            return 1;
-        }
+		return;
+	}
+#endif
 
-        files[CST].self = (uint64_t *)alloc_buff;
-    }
+#ifdef FVM_DISK_THREADS
+	disk_queue.stop = 0;
 
-    fvm_registers[CSP] = files[CST].length - 1; // Set CSP to new value
+	for(disk_queue.started = 0; disk_queue.started < DISK_THREADS; disk_queue.started++) // As many threads as can be started
+		if(pthread_create(&disk_queue.threads[disk_queue.started], NULL, disk_queue_thread, NULL))
+			break;
 
-    files[CST].self[fvm_registers[CSP]] = fvm_registers[CEA]; // Push CEA onto the Callstack
-    fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = the address being called upon, take one to combat the increment of CEA each cycle
+	if(disk_queue.started)
+		disk_queue.backend = BACKEND_THREADS;
+#endif
+}
 
-    return 0;
+void disk_queue_stop(void) { // Stop whatever's carrying out requests (once every request has been waited for)
+#ifdef FVM_DISK_THREADS
+	if(disk_queue.backend == BACKEND_THREADS) {
+		pthread_mutex_lock(&disk_queue.lock);
+
+		disk_queue.stop = 1;
+
+		pthread_cond_broadcast(&disk_queue.changed);
+		pthread_mutex_unlock(&disk_queue.lock);
+
+		while(disk_queue.started)
+			pthread_join(disk_queue.threads[--disk_queue.started], NULL);
+	}
+#endif
+
+#ifdef FVM_IO_URING
+	if(disk_queue.backend == BACKEND_IO_URING) {
+		munmap(disk_queue.sqes_mapping, disk_queue.sqes_size);
+		munmap(disk_queue.rings, disk_queue.rings_size);
+		close(disk_queue.ring);
+	}
+#endif
+
+	disk_queue.backend = BACKEND_SYNC;
 }
 
-_Bool return_address(void) { // rt
-    if(!(fvm_registers[CSP] + 1)) { // If there is nothing to pop from the Callstack
-        fprintf(stderr, "fvmr -> Callstack underflow");
+ssize_t disk_request_wait(uint64_t index) { // Wait for the request at index to be done, freeing its slot and giving its result (reporting it, and giving -1, if it was a write that failed)
+	struct fvm_disk_request *request = &disk_queue.requests[index];
+	ssize_t result;
 
-        return 1;
-    }
+#ifdef FVM_IO_URING
+	while(disk_queue.backend == BACKEND_IO_URING && request->state != REQUEST_DONE)
+		if(disk_ring_enter(1))
+			return -1;
+#endif
 
-    // Otherwise:
+	disk_queue_lock();
 
-    files[CST].length = fvm_registers[CSP]; // Reassign the length of the callstack to the value of CSP before decrementing CSP
-    fvm_registers[CEA] = files[CST].self[fvm_registers[CSP]--] + 1; // CEA = pop(CST), plus 1 to not try to run the operand of the call as an instruction after return
+#ifdef FVM_DISK_THREADS
+	while(disk_queue.backend == BACKEND_THREADS && request->state != REQUEST_DONE)
+		pthread_cond_wait(&disk_queue.changed, &disk_queue.lock);
+#endif
 
-    return 0;
+	result = request->result;
+	request->state = REQUEST_FREE;
+
+	disk_queue_unlock();
+
+	if(request->write) {
+		free(request->buffer);
+
+		if(result != (ssize_t)request->size) {
+			errno = result < 0 ? -result : EIO; // (A short write means there was no room left for the rest)
+			perror("fvmr -> Failure writing to disk");
+
+			return -1;
+		}
+	}
+
+	return result;
 }
 
-_Bool (*instructions[NO_INSTRUCTIONS])(void) = { // Array of function-pointers for each instruction
-	[0] = &place,
-	[1] = &move,
-	[2] = &store,
-	[3] = &load,
-	[4] = &jump,
-	[5] = &jump_if_set,
-	[6] = &jump_if_clear,
-	[7] = &accumulator_add,
-	[8] = &accumulator_sub,
-	[9] = &accumulator_not,
-	[10] = &accumulator_increment,
-	[11] = &accumulator_decrement,
-	[12] = &accumulator_mul,
-	[13] = &accumulator_div,
-	[14] = &accumulator_and,
-	[15] = &accumulator_or,
-	[16] = &accumulator_xor,
-	[17] = &accumulator_lsh,
-	[18] = &accumulator_rsh,
-	[19] = &accumulator_gt,
-	[20] = &accumulator_lt,
-	[21] = &accumulator_ge,
-	[22] = &accumulator_le,
-	[23] = &accumulator_eq,
-	[24] = &accumulator_ne,
-	[25] = &call_address,
-	[26] = &return_address
-};
+int disk_request(_Bool write, uint8_t *buffer, uint64_t size, uint64_t offset) { // Queue reading size bytes at offset into buffer, or writing them from it (in which case it's freed once they've been written), giving the index of the request (or -1 if it can't be queued, because a write had to be waited for to make room for it, and failed)
+	int index, oldest;
 
-int fvmr_run(void) { // Entry point:
-	FILE *f;
+	for(;;) { // Find a free slot, making one by waiting for the oldest write if there isn't one (there's only ever one read, so there's always a write)
+		index = oldest = -1;
 
-	if((files[CST] = (struct fvm_file){.self = calloc(ALLOC_SIZE, sizeof(uint64_t)), .size = ALLOC_SIZE, .length = 0}).self == NULL) { // Try to initialise Callstack
-		perror("fvmr -> Could not allocate memory for Callstack");
+		disk_queue_lock();
 
-		return 3;
-    }
+		for(int i = 0; i < DISK_QUEUE_SIZE && index < 0; i++)
+			if(disk_queue.requests[i].state == REQUEST_FREE)
+				index = i;
+			else if(disk_queue.requests[i].write && (oldest < 0 || disk_queue.requests[i].sequence < disk_queue.requests[oldest].sequence))
+				oldest = i;
 
-	if((f = fopen(FVM_ROM, "rb")) == NULL) { // Try to open ROM file
-		perror("fvmr -> Could not access ROM");
+		disk_queue_unlock();
 
-        free(files[CST].self);
+		if(index >= 0)
+			break;
 
-		return 2;
-	}	
+		if(disk_request_wait(oldest) < 0)
+			return -1;
+	}
 
-    // Get size of ROM:
+	disk_queue_lock();
 
-	files[MEM].size = 0;
+	disk_queue.requests[index] = (struct fvm_disk_request){.buffer = buffer, .offset = offset, .size = size, .sequence = disk_queue.sequence++, .write = write, .state = REQUEST_QUEUED};
 
-	while(fgetc(f) != EOF) files[MEM].size++; // TODO: Replace with solution using fseek()
+	switch(disk_queue.backend) {
+		case BACKEND_SYNC:
+			disk_queue.requests[index].result = disk_transfer(write, buffer, size, offset);
+			disk_queue.requests[index].state = REQUEST_DONE;
 
-	rewind(f); // Go back to beginning of file once number of bytes has been counted
+			break;
+		case BACKEND_THREADS:
+#ifdef FVM_DISK_THREADS
+			pthread_cond_broadcast(&disk_queue.changed);
+#endif
 
-    files[MEM].size = files[MEM].size / 4 + 1; // Divide it by 4 (plus 1 incase of truncation), since fgetc() counts bytes, not qwords
+			break;
+		case BACKEND_IO_URING:
+#ifdef FVM_IO_URING
+			disk_ring_queue(index);
 
-	files[MEM].length = files[MEM].size;
+			if(!write || disk_queue.unsubmitted >= DISK_WRITE_BATCH) // Reads are submitted straight away (along with any writes before them), and writes once there's a batch of them (or when anything is waited for)
+				disk_ring_enter(0); // (If they can't be submitted now, they will be when they're waited for)
+#endif
 
-	if((files[MEM].self = calloc(files[MEM].size, sizeof(uint64_t))) == NULL) { // Attempt to allocate space for Main Memory to contain ROM 
-		perror("fvmr -> Could not allocate memory for Main Memory");
+			break;
+	}
 
-        free(files[CST].self);
+	disk_queue_unlock();
 
-		fclose(f);
+	return index;
+}
+
+_Bool disk_wait_writes(uint64_t offset, uint64_t size) { // Wait for every queued write that overlaps size bytes from offset (so that they happen in order, and anything reading there sees them), returning whether any of them failed
+	_Bool failed = 0, overlaps;
+
+	for(uint64_t i = 0; i < DISK_QUEUE_SIZE; i++) {
+		disk_queue_lock();
+
+		overlaps = disk_queue.requests[i].state != REQUEST_FREE && disk_queue.requests[i].write && disk_queue.requests[i].offset < offset + size && offset < disk_queue.requests[i].offset + disk_queue.requests[i].size;
+
+		disk_queue_unlock();
 
-		return 3;
+		if(overlaps)
+			failed |= disk_request_wait(i) < 0;
 	}
 
-	fread(files[MEM].self, files[MEM].size, sizeof(uint64_t), f); // Load ROM into Main Memory
+	return failed;
+}
 
-	fclose(f); // Close ROM
+_Bool disk_ahead_start(uint64_t offset, uint64_t size) { // Queue reading size bytes from offset into the spare buffer, while the program carries on with the buffer (if there's no spare buffer to read into, it's just not read ahead), returning whether a write had to be waited for first, and failed
+	if(disk.spare == NULL && (disk.spare = (uint8_t *)malloc(DISK_BUFFER_SIZE)) == NULL)
+		return 0;
 
-    if((disk = fopen(FVM_DISK, "rb+")) == NULL) { // Try to open Secondary Storage for runtime
-        perror("fvmr -> Could not access Disk");
+	if(disk_wait_writes(offset, size)) // So that it reads what's been written there
+		return 1;
 
-        free(files[CST].self);
-        free(files[MEM].self);
+	disk.ahead_offset = offset;
+	disk.ahead_size = size;
 
-        return 2;
-    }
+	return (disk.ahead_request = disk_request(0, disk.spare, size, offset)) < 0;
+}
 
-    // Begin execution:
+ssize_t disk_ahead_finish(void) { // Wait for anything being read ahead, giving the number of bytes read into the spare buffer (negative if there aren't any)
+	ssize_t length;
 
-	for(fvm_registers[CEA] = 0; files[MEM].self[fvm_registers[CEA]] != 27; fvm_registers[CEA]++) { // Traverse instructions until instruction 27 (fi - finish) is encountered
-		if(files[MEM].self[fvm_registers[CEA]] >= NO_INSTRUCTIONS) { // If a number is encountered that should be an instruction but isn't in the instructions list
-			fprintf(stderr, "fvmr -> Encountered unknown instruction '%zu'\n", files[MEM].self[fvm_registers[CEA]]);
+	if(disk.ahead_request < 0)
+		return -1;
 
-			traceback();
+	length = disk_request_wait(disk.ahead_request);
 
-            free(files[CST].self);
-            free(files[MEM].self);
+	disk.ahead_request = -1;
 
-			return 4;
-		}
+	return length;
+}
 
-        if(instructions[files[MEM].self[fvm_registers[CEA]]]()) { // Otherwise, try to execute the current instruction. If it returns a failed status, exit safely
-			traceback();
+_Bool disk_flush(void) { // Queue whatever has been written to the buffer to be written to the disk itself, in one go
+	uint64_t size = disk.dirty_end - disk.dirty_start, offset = disk.start + disk.dirty_start;
+	uint8_t *bytes;
+	ssize_t written;
+
+	if(!size)
+		return 0;
+
+	if(disk_wait_writes(offset, size)) // Writes to the same place have to be made in the order they were queued
+		return 1;
+
+	if((bytes = (uint8_t *)malloc(size)) == NULL) { // The request gets a copy of the bytes, so that the buffer can carry on being used while they're written
+		if((written = disk_transfer(1, disk.buffer + disk.dirty_start, size, offset)) != (ssize_t)size) { // If there isn't the memory for one, just write them now
+			errno = written < 0 ? -written : EIO;
+			perror("fvmr -> Failure writing to disk");
+
+			return 1;
+		}
+	} else {
+		memcpy(bytes, disk.buffer + disk.dirty_start, size);
 
-            free(files[CST].self);
-            free(files[MEM].self);
+		if(disk_request(1, bytes, size, offset) < 0) {
+			free(bytes);
 
-			return 4;
+			return 1;
 		}
 	}
 
-    // Cleanup:
+	disk.dirty_start = disk.dirty_end = 0;
 
-    free(files[CST].self);
-    free(files[MEM].self);
+	return 0;
+}
+
+_Bool disk_invalidate(void) { // Flush the buffer and empty it, and wait for everything queued, so that the disk is read again (for when it might have been changed by something else), and is up to date for anything else that reads it
+	if(disk_flush())
+		return 1;
+
+	disk.length = 0;
+
+	disk_ahead_finish(); // Anything read ahead might be out of date too
+
+	return disk_wait_writes(0, UINT64_MAX);
+}
+
+_Bool disk_refill(void) { // Fill the buffer from the offset
+	ssize_t read;
+	_Bool sequential;
+	uint8_t *buffer;
+
+	if(disk_flush())
+		return 1;
+
+	if((sequential = disk.length && disk.offset == disk.start + disk.length)) // If the offset carries on from what was in the buffer, it's being read sequentially, so read twice as far ahead as last time
+		disk.ahead = disk.ahead * 2 < DISK_BUFFER_SIZE ? disk.ahead * 2 : DISK_BUFFER_SIZE;
+	else
+		disk.ahead = DISK_BLOCK_SIZE;
+
+	if((read = disk_ahead_finish()) >= 0 && disk.ahead_offset == disk.offset) { // If it's been read from here already, swap that buffer in instead of reading it again
+		buffer = disk.buffer;
+		disk.buffer = disk.spare;
+		disk.spare = buffer;
+	} else if(disk_wait_writes(disk.offset, disk.ahead)) { // Otherwise, read it now (once anything queued to be written there has been)
+		return 1;
+	} else if((read = disk_transfer(0, disk.buffer, disk.ahead, disk.offset)) < 0) {
+		errno = -read;
+		perror("fvmr -> Failure reading from disk");
+
+		return 1;
+	}
+
+	disk.start = disk.offset;
+	disk.length = read;
+
+	if(sequential && read) // Start reading the next part, so that it's ready by the time the program gets there
+		return disk_ahead_start(disk.start + disk.length, disk.ahead);
+
+	return 0;
+}
+
+_Bool disk_open(void) { // Open the disk file (if it isn't already), with an empty buffer. This is left until the disk is first used, so that runs that never use it (such as routines evaluated by fvma) don't need it to exist
+	if(disk.fd >= 0)
+		return 0;
+
+	if((disk.fd = open(FVM_DISK, O_RDWR)) < 0) {
+		perror("fvmr -> Could not access Disk");
+
+		return 1;
+	}
+
+	if((disk.buffer = (uint8_t *)malloc(DISK_BUFFER_SIZE)) == NULL) {
+		perror("fvmr -> Could not allocate memory for disk buffer");
+
+		close(disk.fd);
+
+		disk.fd = -1;
+
+		return 1;
+	}
+
+	disk.start = disk.length = disk.dirty_start = disk.dirty_end = 0; // (The offset is left as it is, since it can be set before the disk is opened)
+	disk.ahead = DISK_BLOCK_SIZE;
+
+	disk_queue_start();
+
+	return 0;
+}
+
+struct fvm_disk_window { // (See the disk window, below)
+	uint64_t *self, // Mapped words of the disk (NULL if it isn't mapped)
+			 length; // Number of words mapped
+} disk_window;
+
+_Bool disk_window_read_bytes(uint8_t *bytes, uint64_t *count) { // Read up to *count bytes from the offset while the disk is mapped, from the window itself (and the disk past its last whole word), so that they're always what was last written through it
+	uint64_t mapped = disk_window.length * sizeof(uint64_t),
+			 n = 0;
+	ssize_t read;
+
+	if(disk.offset < mapped) { // As much as is in the window
+		n = *count < mapped - disk.offset ? *count : mapped - disk.offset;
+
+		memcpy(bytes, (uint8_t *)disk_window.self + disk.offset, n);
+	}
+
+	if(n < *count) { // And the rest from past it
+		if((read = pread(disk.fd, bytes + n, *count - n, disk.offset + n)) < 0) {
+			perror("fvmr -> Failure reading from disk");
+
+			return 1;
+		}
+
+		n += read;
+	}
+
+	disk.offset += n;
+	*count = n;
+
+	return 0;
+}
+
+_Bool disk_window_write_bytes(const uint8_t *bytes, uint64_t count) { // Write count bytes at the offset while the disk is mapped, into the window itself (and the disk past its last whole word), so that it sees them straight away
+	uint64_t mapped = disk_window.length * sizeof(uint64_t),
+			 n = 0;
+
+	if(disk.offset < mapped) { // As much as is in the window
+		n = count < mapped - disk.offset ? count : mapped - disk.offset;
+
+		memcpy((uint8_t *)disk_window.self + disk.offset, bytes, n);
+	}
+
+	if(n < count && pwrite(disk.fd, bytes + n, count - n, disk.offset + n) != (ssize_t)(count - n)) { // And the rest past it
+		perror("fvmr -> Failure writing to disk");
+
+		return 1;
+	}
+
+	disk.offset += count;
+
+	return 0;
+}
+
+_Bool disk_read_bytes(uint8_t *bytes, uint64_t *count) { // Read up to *count bytes from the offset into bytes, setting *count = the number actually read (fewer if the end of the disk is reached)
+	uint64_t done = 0, n;
+
+	if(disk_open())
+		return 1;
+
+	if(disk_window.self != NULL) // The buffer is left alone while the disk is mapped (it was emptied when it was mapped), since it wouldn't see what's written through the window
+		return disk_window_read_bytes(bytes, count);
+
+	while(done < *count) {
+		if(disk.offset < disk.start || disk.offset >= disk.start + disk.length) { // If the offset isn't in the buffer, fill it from there
+			if(disk_refill())
+				return 1;
+
+			if(!disk.length) // Nothing was read, so it's the end of the disk
+				break;
+		}
+
+		n = *count - done < disk.start + disk.length - disk.offset ? *count - done : disk.start + disk.length - disk.offset; // As much as is wanted, or is in the buffer
+
+		memcpy(bytes + done, disk.buffer + (disk.offset - disk.start), n);
+
+		disk.offset += n;
+		done += n;
+	}
+
+	*count = done;
+
+	return 0;
+}
+
+_Bool disk_write_bytes(const uint8_t *bytes, uint64_t count) { // Write count bytes at the offset (into the buffer, to be flushed to the disk later)
+	uint64_t n;
+
+	if(disk_open())
+		return 1;
+
+	if(disk_window.self != NULL) // (As with reading)
+		return disk_window_write_bytes(bytes, count);
+
+	if(disk.ahead_request >= 0 && disk.offset < disk.ahead_offset + disk.ahead_size && disk.offset + count > disk.ahead_offset) // If it's where the disk is being read ahead, what's read will be out of date
+		disk_ahead_finish();
+
+	while(count) {
+		if(disk.offset < disk.start || disk.offset > disk.start + disk.length || disk.offset == disk.start + DISK_BUFFER_SIZE) { // If the offset doesn't carry on from what's in the buffer, or the buffer is full, start it again from there
+			if(disk_flush())
+				return 1;
+
+			disk.start = disk.offset;
+			disk.length = 0;
+		}
+
+		n = count < disk.start + DISK_BUFFER_SIZE - disk.offset ? count : disk.start + DISK_BUFFER_SIZE - disk.offset; // As much as is given, or fits in the buffer
+
+		memcpy(disk.buffer + (disk.offset - disk.start), bytes, n);
+
+		if(disk.dirty_end > disk.dirty_start) { // Add it to the range to be flushed
+			disk.dirty_start = disk.offset - disk.start < disk.dirty_start ? disk.offset - disk.start : disk.dirty_start;
+			disk.dirty_end = disk.offset - disk.start + n > disk.dirty_end ? disk.offset - disk.start + n : disk.dirty_end;
+		} else {
+			disk.dirty_start = disk.offset - disk.start;
+			disk.dirty_end = disk.offset - disk.start + n;
+		}
+
+		disk.offset += n;
+		bytes += n;
+		count -= n;
+
+		if(disk.offset - disk.start > disk.length) // Including anything written past the end of what was there
+			disk.length = disk.offset - disk.start;
+	}
+
+	return 0;
+}
+
+void disk_close(void) { // Flush the buffer and close the disk file (if it's open)
+	if(disk.fd < 0)
+		return;
+
+	disk_invalidate(); // Flush the buffer, and wait for everything queued
+
+	disk_queue_stop();
+
+	free(disk.buffer);
+	free(disk.spare);
+	close(disk.fd);
+
+	disk = (struct fvm_disk){.fd = -1, .ahead_request = -1};
+}
+
+// Disk window, mapping the disk into Main Memory from DISK_WINDOW_BASE, as one word for every 8 bytes of it (in the host's byte order). While it's mapped, reading and writing the disk byte-by-byte goes through the window too:
+
+void disk_window_unmap(void) { // Unmap the window, leaving whatever was written through it in the disk
+	if(disk_window.self == NULL)
+		return;
+
+	munmap(disk_window.self, disk_window.length * sizeof(uint64_t));
+	disk_invalidate(); // Make sure that reading the disk byte-by-byte sees what was written through the window
+
+	disk_window = (struct fvm_disk_window){0};
+}
+
+_Bool disk_window_map(void) { // Map every whole word of the disk into the window
+	struct stat info;
+	void *mapping;
+
+	disk_window_unmap(); // If it's already mapped, map it again (so that it's the disk's current size)
+
+	if(disk_open() || disk_invalidate()) // Make sure that anything written to the disk byte-by-byte is in it before it's mapped
+		return 1;
+
+	if(fstat(disk.fd, &info)) {
+		perror("fvmr -> Failure getting size of disk");
+
+		return 1;
+	}
+
+	if((uint64_t)info.st_size < sizeof(uint64_t)) // If there isn't a whole word to map, leave the window empty
+		return 0;
+
+	if((mapping = mmap(NULL, (uint64_t)info.st_size / sizeof(uint64_t) * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, disk.fd, 0)) == MAP_FAILED) {
+		perror("fvmr -> Failure mapping disk into Main Memory");
+
+		return 1;
+	}
+
+	disk_window.self = (uint64_t *)mapping;
+	disk_window.length = (uint64_t)info.st_size / sizeof(uint64_t);
+
+	return 0;
+}
+
+uint64_t *channel_pointer(uint64_t channel, uint64_t address) { // Pointer to address in a stored memory channel (which must have been reserved)
+	if(channel == MEM && address >= DISK_WINDOW_BASE)
+		return disk_window.self + (address - DISK_WINDOW_BASE);
+
+	return files[channel].self + address;
+}
+
+_Bool channel_reserve(uint64_t channel, uint64_t address, uint64_t count) { // Make sure that count words from address can be accessed in a stored memory channel
+	if(address + count < address) { // If the range wraps around the address space
+		fprintf(stderr, "fvmr -> Block of %zu words at address '%zu' is out of range\n", count, address);
+
+		return 1;
+	}
+
+	if(channel == MEM && (address >= DISK_WINDOW_BASE || address + count > DISK_WINDOW_BASE)) { // Main Memory from DISK_WINDOW_BASE is the disk window, which can't grow
+		if(address < DISK_WINDOW_BASE || address - DISK_WINDOW_BASE + count > disk_window.length) {
+			fprintf(stderr, "fvmr -> Block of %zu words at address '%zu' is outside of the disk window\n", count, address);
+
+			return 1;
+		}
+
+		return 0;
+	}
+
+	if(address > SIZE_MAX / sizeof(uint64_t) || count > SIZE_MAX / sizeof(uint64_t) - address) { // If the range has more bytes than could ever be allocated (so they'd wrap around when counted)
+		fprintf(stderr, "fvmr -> Block of %zu words at address '%zu' is too big to allocate\n", count, address);
+
+		return 1;
+	}
+
+	if(address + count > files[channel].size) { // If it's bigger than what's allocated
+		if((alloc_buff = (void *)realloc(files[channel].self, (address + count) * sizeof(uint64_t))) == NULL) { // Attempt to reallocate the channel more space to accomodate the block
+			perror("fvmr -> Failure reallocating memory for block operation");
+
+			return 1;
+		}
+
+		files[channel].self = (uint64_t *)alloc_buff;
+		files[channel].size = address + count;
+	}
+
+	if(channel == MEM && address + count > files[MEM].length) // Main Memory also keeps track of how much of it is used
+		files[MEM].length = address + count;
+
+	return 0;
+}
+
+uint64_t main_memory_extent(uint64_t address, uint64_t count) { // Number of the count words from address that are in Main Memory already (up to the end of what's been used, or of the disk window), for looking through without growing it
+	uint64_t end = address >= DISK_WINDOW_BASE ? DISK_WINDOW_BASE + disk_window.length : files[MEM].length;
+
+	return address >= end ? 0 : end - address < count ? end - address : count;
+}
+
+struct fvm_file capture; // Where words written to stdout go instead while a routine is being evaluated ahead of time (self is NULL otherwise, and length counts every word, even those past size)
+
+void capture_word(uint64_t value) { // Keep value as the next word written to stdout while it's being captured
+	if(capture.length < capture.size)
+		capture.self[capture.length] = value;
+
+	capture.length++;
+}
+
+uint64_t stdout_write_bytes(const uint8_t *bytes, uint64_t count) { // Write count bytes to stdout (or, while it's being captured, each into a word of its own), returning how many were written
+	if(capture.self == NULL)
+		return fwrite(bytes, sizeof(uint8_t), count, stdout);
+
+	for(uint64_t i = 0; i < count; i++)
+		capture_word(bytes[i]);
+
+	return count;
+}
+
+void write_number(uint64_t value) { // Write value to stdout in number_base, in one go
+	char digits[64]; // Enough for any value in base 2
+	size_t length = sizeof(digits);
+
+	do { // Fill in the digits from the end, least significant first
+		digits[--length] = NUMBER_DIGITS[value % number_base];
+		value /= number_base;
+	} while(value);
+
+	stdout_write_bytes((uint8_t *)digits + length, sizeof(digits) - length);
+}
+
+uint64_t read_number(void) { // Read a number in number_base from stdin, skipping any whitespace before it and leaving whatever comes after it to be read. Gives UINT64_MAX (the same as reading EOF as a character) if the input ends before any digits, or if there aren't any digits or the number doesn't fit in a word (setting input.status = INPUT_INVALID)
+	int c;
+	uint64_t value = 0, digits = 0;
+	_Bool overflow = 0;
+	const char *digit;
+
+	while(isspace(c = input_getc())); // Skip any whitespace
+
+	if(c == EOF)
+		return UINT64_MAX;
+
+	for(; c != EOF && (digit = memchr(NUMBER_DIGITS, tolower(c), number_base)) != NULL; digits++) { // Accumulate the value of each digit, for as long as there are digits (all of which are read, even once it's too big)
+		overflow |= value > (UINT64_MAX - (uint64_t)(digit - NUMBER_DIGITS)) / number_base;
+		value = value * number_base + (digit - NUMBER_DIGITS);
+		c = input_getc();
+	}
+
+	if(c != EOF) // Leave the character that ended the number to be read (which is always still in the buffer, just before the next one)
+		input.position--;
+
+	if(!digits || overflow) { // So that neither can be mistaken for a number that was actually read
+		input.status = INPUT_INVALID;
+
+		return UINT64_MAX;
+	}
+
+	return value;
+}
+
+// Peripherals, which are host file descriptors (files, pipes and Unix sockets) that are read and written without ever blocking, one per endpoint from PERIPHERAL_ENDPOINT on both Input and Output:
+
+struct fvm_peripheral {
+	int fd; // File descriptor
+	_Bool open, // Whether the slot is in use
+		  socket, // Whether fd is a socket (so that writing to one whose other end has closed can be kept from raising SIGPIPE)
+		  always_ready; // Whether fd can't be waited for, because it's always ready (as regular files are)
+};
+
+struct fvm_peripherals {
+	struct fvm_peripheral slots[NO_PERIPHERALS];
+	uint64_t timeout, // Milliseconds that waiting for a peripheral gives up after (UINT64_MAX to wait for as long as it takes)
+			 next; // Slot to start looking for a ready peripheral from, so that they all take turns
+#ifdef FVM_EPOLL
+	int epoll; // epoll instance watching every open peripheral that can be waited for
+	_Bool epoll_open; // Whether epoll has been created yet (it's only needed once something is opened)
+#endif
+} peripherals = {.timeout = UINT64_MAX};
+
+uint64_t peripheral_add(int fd, _Bool socket) { // Make fd non-blocking and give it a slot, returning its endpoint (or UINT64_MAX if it can't have one, in which case it's left as it was)
+	uint64_t slot;
+	int flags;
+
+	for(slot = 0; slot < NO_PERIPHERALS && peripherals.slots[slot].open; slot++); // Find a free slot
+
+	if(slot == NO_PERIPHERALS)
+		return UINT64_MAX;
+
+	if((flags = fcntl(fd, F_GETFL)) < 0)
+		return UINT64_MAX;
+
+	peripherals.slots[slot] = (struct fvm_peripheral){.fd = fd, .open = 1, .socket = socket};
+
+#ifdef FVM_EPOLL
+	if(!peripherals.epoll_open) { // Create epoll the first time anything is opened
+		if((peripherals.epoll = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+			perror("fvmr -> Could not create epoll instance for peripherals");
+
+			peripherals.slots[slot].open = 0;
+
+			return UINT64_MAX;
+		}
+
+		peripherals.epoll_open = 1;
+	}
+
+	if(epoll_ctl(peripherals.epoll, EPOLL_CTL_ADD, fd, &(struct epoll_event){.events = EPOLLIN | EPOLLRDHUP, .data.u64 = slot})) { // Watch it for input (or the other end hanging up)
+		if(errno != EPERM) { // (epoll refuses regular files, which never have to be waited for anyway)
+			perror("fvmr -> Could not watch peripheral");
+
+			peripherals.slots[slot].open = 0;
+
+			return UINT64_MAX;
+		}
+
+		peripherals.slots[slot].always_ready = 1;
+	}
+#else
+	struct stat info;
+
+	peripherals.slots[slot].always_ready = !fstat(fd, &info) && S_ISREG(info.st_mode);
+#endif
+
+	if(fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) { // Only made non-blocking once nothing else can fail, so that it's never left changed
+#ifdef FVM_EPOLL
+		if(!peripherals.slots[slot].always_ready)
+			epoll_ctl(peripherals.epoll, EPOLL_CTL_DEL, fd, NULL);
+#endif
+
+		peripherals.slots[slot].open = 0;
+
+		return UINT64_MAX;
+	}
+
+	return PERIPHERAL_ENDPOINT + slot;
+}
+
+uint64_t fvmr_attach_peripheral(int fd) { // Let the next run use fd (which it will close when it finishes) as a peripheral, returning the endpoint it's on (or UINT64_MAX if it can't be attached)
+	struct stat info;
+
+	return fstat(fd, &info) ? UINT64_MAX : peripheral_add(fd, S_ISSOCK(info.st_mode));
+}
+
+_Bool peripheral_open(uint64_t address, uint64_t *endpoint) { // Open the path stored as a string at address in Main Memory (one character per word, ending with 0) as a peripheral, setting *endpoint = the endpoint it's on (or UINT64_MAX if it can't be opened)
+	char path[MAX_PATH_LENGTH];
+	struct stat info;
+	struct sockaddr_un socket_address = {.sun_family = AF_UNIX};
+	int fd;
+	uint64_t i;
+
+	for(i = 0; i < MAX_PATH_LENGTH && main_memory_extent(address + i, 1); i++) // Copy the path out of Main Memory (as much of it as there is)
+		if(!(path[i] = (char)*channel_pointer(MEM, address + i)))
+			break;
+
+	if(i < MAX_PATH_LENGTH && !main_memory_extent(address + i, 1)) { // If Main Memory ended before the path did
+		fprintf(stderr, "fvmr -> Attempted to open peripheral with a path at address '%zu' that isn't ended within Main Memory\n", address);
+
+		return 1;
+	}
+
+	if(i == MAX_PATH_LENGTH) {
+		fprintf(stderr, "fvmr -> Attempted to open peripheral with a path longer than %d characters\n", MAX_PATH_LENGTH - 1);
+
+		return 1;
+	}
+
+	*endpoint = UINT64_MAX; // Failing to open it isn't fatal, so that the program can carry on without it
+
+	if(stat(path, &info))
+		return 0;
+
+	if(S_ISSOCK(info.st_mode)) { // Unix sockets have to be connected to instead of opened
+		if(i >= sizeof(socket_address.sun_path))
+			return 0;
+
+		memcpy(socket_address.sun_path, path, i + 1);
+
+		if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+			return 0;
+
+		if(connect(fd, (struct sockaddr *)&socket_address, sizeof(socket_address))) { // (Connecting before it's made non-blocking, so that it's ready to use straight away)
+			close(fd);
+
+			return 0;
+		}
+	} else if((fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK)) < 0 && (fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK)) < 0) // Opened for reading and writing if possible, or just reading if not
+		return 0;
+
+	if((*endpoint = peripheral_add(fd, S_ISSOCK(info.st_mode))) == UINT64_MAX)
+		close(fd);
+
+	return 0;
+}
+
+struct fvm_peripheral *peripheral_slot(uint64_t endpoint) { // The peripheral open on endpoint, or NULL (after reporting it) if there isn't one
+	if(endpoint < PERIPHERAL_ENDPOINT || endpoint - PERIPHERAL_ENDPOINT >= NO_PERIPHERALS || !peripherals.slots[endpoint - PERIPHERAL_ENDPOINT].open) {
+		fprintf(stderr, "fvmr -> Attempted to use endpoint '%zu', which doesn't have a peripheral open on it\n", endpoint);
+
+		return NULL;
+	}
+
+	return &peripherals.slots[endpoint - PERIPHERAL_ENDPOINT];
+}
+
+_Bool peripheral_close(uint64_t endpoint) { // Close the peripheral on endpoint, freeing its slot
+	struct fvm_peripheral *peripheral;
+
+	if((peripheral = peripheral_slot(endpoint)) == NULL)
+		return 1;
+
+#ifdef FVM_EPOLL
+	if(!peripheral->always_ready) // Stop watching it first, in case something else still has the file open
+		epoll_ctl(peripherals.epoll, EPOLL_CTL_DEL, peripheral->fd, NULL);
+#endif
+
+	close(peripheral->fd);
+
+	peripheral->open = 0;
+
+	return 0;
+}
+
+void peripherals_close(void) { // Close every peripheral (once a run has finished)
+	for(uint64_t slot = 0; slot < NO_PERIPHERALS; slot++)
+		if(peripherals.slots[slot].open)
+			peripheral_close(PERIPHERAL_ENDPOINT + slot);
+
+#ifdef FVM_EPOLL
+	if(peripherals.epoll_open)
+		close(peripherals.epoll);
+
+	peripherals.epoll_open = 0;
+#endif
+
+	peripherals.timeout = UINT64_MAX;
+	peripherals.next = 0;
+}
+
+_Bool peripheral_wait(uint64_t *endpoint) { // Wait up to peripherals.timeout milliseconds for a peripheral to have input (or to have hung up), setting *endpoint = the first that does (or UINT64_MAX if none do in time)
+	int timeout = peripherals.timeout == UINT64_MAX ? -1 : peripherals.timeout > INT_MAX ? INT_MAX : (int)peripherals.timeout,
+		ready;
+	uint64_t slot,
+			 watched = 0;
+
+	fflush(stdout); // So that anything the peripherals are being waited on for is seen first
+
+	*endpoint = UINT64_MAX;
+
+	for(uint64_t i = 0; i < NO_PERIPHERALS; i++) { // Peripherals that are always ready don't need waiting for
+		slot = (peripherals.next + i) % NO_PERIPHERALS;
+
+		if(peripherals.slots[slot].open && peripherals.slots[slot].always_ready) {
+			*endpoint = PERIPHERAL_ENDPOINT + slot;
+			peripherals.next = slot + 1;
+
+			return 0;
+		}
+
+		watched += peripherals.slots[slot].open;
+	}
+
+	if(!watched) // Nothing could ever become ready
+		return 0;
+
+#ifdef FVM_EPOLL
+	struct epoll_event event;
+
+	while((ready = epoll_wait(peripherals.epoll, &event, 1, timeout)) < 0 && errno == EINTR); // Only one at a time, which epoll hands out in turn
+
+	if(ready < 0) {
+		perror("fvmr -> Failure waiting for peripherals");
+
+		return 1;
+	}
+
+	if(ready)
+		*endpoint = PERIPHERAL_ENDPOINT + event.data.u64;
+#else
+	struct pollfd fds[NO_PERIPHERALS];
+
+	for(slot = 0; slot < NO_PERIPHERALS; slot++) // Slots that aren't open have a negative fd, which poll ignores
+		fds[slot] = (struct pollfd){.fd = peripherals.slots[slot].open ? peripherals.slots[slot].fd : -1, .events = POLLIN};
+
+	while((ready = poll(fds, NO_PERIPHERALS, timeout)) < 0 && errno == EINTR);
+
+	if(ready < 0) {
+		perror("fvmr -> Failure waiting for peripherals");
+
+		return 1;
+	}
+
+	for(uint64_t i = 0; ready && i < NO_PERIPHERALS; i++) { // Take the first ready one, starting after the last one that was
+		slot = (peripherals.next + i) % NO_PERIPHERALS;
+
+		if(fds[slot].revents) {
+			*endpoint = PERIPHERAL_ENDPOINT + slot;
+			peripherals.next = slot + 1;
+
+			break;
+		}
+	}
+#endif
+
+	return 0;
+}
+
+_Bool peripheral_read_bytes(uint64_t endpoint, uint8_t *bytes, uint64_t *count) { // Read up to *count bytes from the peripheral on endpoint, as many as are ready, setting *count = the number read and input.status to what happened
+	struct fvm_peripheral *peripheral;
+	ssize_t n;
+
+	if((peripheral = peripheral_slot(endpoint)) == NULL)
+		return 1;
+
+	if(!*count)
+		return 0;
+
+	while((n = read(peripheral->fd, bytes, *count)) < 0 && errno == EINTR);
+
+	if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNRESET) {
+		perror("fvmr -> Failure reading from peripheral");
+
+		return 1;
+	}
+
+	if(n < 0) // Nothing was ready (or the other end went away, which is the same as it ending)
+		input.status = errno == ECONNRESET ? INPUT_END : INPUT_WAITING;
+	else
+		input.status = !n ? INPUT_END : (uint64_t)n < *count ? INPUT_WAITING : INPUT_READ;
+
+	*count = n > 0 ? n : 0;
+
+	return 0;
+}
+
+ssize_t peripheral_write_fd(struct fvm_peripheral *peripheral, const uint8_t *bytes, uint64_t count) { // Write count bytes to a peripheral's fd, failing with EPIPE (rather than raising SIGPIPE, which would kill the host) if what it leads to has been closed
+#ifdef FVM_SIGPIPE
+	sigset_t pipe_signal, pending, mask;
+	ssize_t n;
+	int error;
+#endif
+
+	if(peripheral->socket) // Sockets can be told not to raise it
+		return send(peripheral->fd, bytes, count, MSG_NOSIGNAL);
+
+#ifdef FVM_SIGPIPE
+	sigemptyset(&pipe_signal); // Pipes can't, so it's blocked while writing
+	sigaddset(&pipe_signal, SIGPIPE);
+	sigpending(&pending);
+
+	pthread_sigmask(SIG_BLOCK, &pipe_signal, &mask);
+
+	n = write(peripheral->fd, bytes, count);
+	error = errno;
+
+	if(n < 0 && error == EPIPE && !sigismember(&pending, SIGPIPE)) // And if writing raised it, it's taken back before it's unblocked (unless one was already waiting from elsewhere)
+		sigtimedwait(&pipe_signal, NULL, &(struct timespec){0});
+
+	pthread_sigmask(SIG_SETMASK, &mask, NULL);
+
+	errno = error;
+
+	return n;
+#else
+	return write(peripheral->fd, bytes, count);
+#endif
+}
+
+_Bool peripheral_write_bytes(uint64_t endpoint, const uint8_t *bytes, uint64_t *count) { // Write up to *count bytes to the peripheral on endpoint, as many as it will take without blocking, setting *count = the number written and input.status to what happened
+	struct fvm_peripheral *peripheral;
+	ssize_t n;
+
+	if((peripheral = peripheral_slot(endpoint)) == NULL)
+		return 1;
+
+	if(!*count)
+		return 0;
+
+	while((n = peripheral_write_fd(peripheral, bytes, *count)) < 0 && errno == EINTR);
+
+	if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EPIPE && errno != ECONNRESET) {
+		perror("fvmr -> Failure writing to peripheral");
+
+		return 1;
+	}
+
+	if(n < 0) // It couldn't take any more yet (or the other end went away)
+		input.status = errno == EPIPE || errno == ECONNRESET ? INPUT_END : INPUT_WAITING;
+	else
+		input.status = (uint64_t)n < *count ? INPUT_WAITING : INPUT_READ;
+
+	*count = n > 0 ? n : 0;
+
+	return 0;
+}
+
+// Hash maps, of uint64_t keys to uint64_t values (using open addressing with linear probing):
+
+struct fvm_hash_map {
+	uint64_t *keys,
+			 *values,
+			 capacity, // No. slots allocated (0, or a power of two)
+			 length, // No. keys stored
+			 used; // No. slots that aren't empty (keys stored, plus ones that have been deleted)
+	uint8_t *states; // Whether each slot is empty, full, or has had its key deleted
+} hash_map; // The hash map behind HSH and HSC
+
+enum fvm_hash_slot {
+	EMPTY = 0,
+	FULL = 1,
+	DELETED = 2
+};
+
+uint64_t hash(uint64_t key) { // Mix the bits of a key (the splitmix64 finaliser), so that similar keys don't end up in neighbouring slots
+	key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+	key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+
+	return key ^ (key >> 31);
+}
+
+uint64_t hash_map_find(struct fvm_hash_map *map, uint64_t key) { // Find the slot that holds key, or otherwise the slot it should be put in (only call on a map with at least one empty slot)
+	uint64_t slot = hash(key) & (map->capacity - 1),
+			 reusable = map->capacity; // First deleted slot passed over, which a new key can go in instead
+
+	for(; map->states[slot] != EMPTY; slot = (slot + 1) & (map->capacity - 1)) { // Probe until an empty slot means the key isn't there
+		if(map->states[slot] == FULL && map->keys[slot] == key)
+			return slot;
+
+		if(map->states[slot] == DELETED && reusable == map->capacity)
+			reusable = slot;
+	}
+
+	return reusable == map->capacity ? slot : reusable;
+}
+
+_Bool hash_map_resize(struct fvm_hash_map *map, uint64_t capacity) { // Move every key in map into capacity new slots (dropping deleted ones)
+	struct fvm_hash_map resized = {.capacity = capacity};
+	uint64_t slot;
+
+	if((resized.keys = (uint64_t *)malloc(capacity * sizeof(uint64_t))) == NULL
+	|| (resized.values = (uint64_t *)malloc(capacity * sizeof(uint64_t))) == NULL
+	|| (resized.states = (uint8_t *)calloc(capacity, sizeof(uint8_t))) == NULL) { // Attempt to allocate the new slots
+		perror("fvmr -> Failure allocating memory for hash map");
+
+		free(resized.keys);
+		free(resized.values);
+
+		return 1;
+	}
+
+	for(uint64_t i = 0; i < map->capacity; i++) { // Put each key in its slot in the new map
+		if(map->states[i] != FULL)
+			continue;
+
+		slot = hash_map_find(&resized, map->keys[i]);
+
+		resized.keys[slot] = map->keys[i];
+		resized.values[slot] = map->values[i];
+		resized.states[slot] = FULL;
+	}
+
+	resized.length = resized.used = map->length;
+
+	free(map->keys);
+	free(map->values);
+	free(map->states);
+
+	*map = resized;
+
+	return 0;
+}
+
+_Bool hash_map_put(struct fvm_hash_map *map, uint64_t key, uint64_t value) { // Set the value of key in map
+	uint64_t slot;
+
+	if((map->used + 1) * 4 > map->capacity * 3) // Keep at least a quarter of the slots empty, so that probing stays short (growing only if it isn't deleted slots that are filling it)
+		if(hash_map_resize(map, map->capacity ? (map->length + 1) * 2 > map->capacity ? map->capacity * 2 : map->capacity : HASH_MAP_SIZE))
+			return 1;
+
+	slot = hash_map_find(map, key);
+
+	if(map->states[slot] != FULL) { // If it's a new key
+		map->length++;
+
+		if(map->states[slot] == EMPTY)
+			map->used++;
+
+		map->keys[slot] = key;
+		map->states[slot] = FULL;
+	}
+
+	map->values[slot] = value;
+
+	return 0;
+}
+
+_Bool hash_map_get(struct fvm_hash_map *map, uint64_t key, uint64_t *value) { // Set *value = the value of key in map, returning whether it was there
+	uint64_t slot;
+
+	if(!map->capacity || map->states[slot = hash_map_find(map, key)] != FULL)
+		return 0;
+
+	*value = map->values[slot];
+
+	return 1;
+}
+
+void hash_map_delete(struct fvm_hash_map *map, uint64_t key) { // Remove key from map, if it's there
+	uint64_t slot;
+
+	if(!map->capacity || map->states[slot = hash_map_find(map, key)] != FULL)
+		return;
+
+	map->states[slot] = DELETED; // Leave a marker, so that probing for keys after this one carries on past it
+	map->length--;
+}
+
+void hash_map_free(struct fvm_hash_map *map) { // Remove everything from map, and free its memory
+	free(map->keys);
+	free(map->values);
+	free(map->states);
+
+	*map = (struct fvm_hash_map){0};
+}
+
+// Algorithm coprocessor, which works on a range of records in Main Memory, each STRIDE words long and ordered by its first word:
+
+enum fvm_algorithm_address { // Addresses on the Algorithm coprocessor's channel
+	ALGORITHM_BASE = 0, // Parameters, which st sets and ld reads back:
+	ALGORITHM_LENGTH = 1,
+	ALGORITHM_STRIDE = 2,
+	ALGORITHM_KEY = 3,
+	ALGORITHM_SORT = 4, // Operations, which st or ld carries out (ld also giving the result):
+	ALGORITHM_SEARCH = 5,
+	ALGORITHM_REVERSE = 6,
+	ALGORITHM_UNIQUE = 7
+};
+
+uint64_t algorithm_parameters[ALGORITHM_SORT]; // Base address, length (in records), stride (in words), and key
+
+_Bool algorithm_sort(uint64_t *records, uint64_t length, uint64_t stride) { // Stable sort of records by their first word, using an LSD radix sort (8 passes of a byte each)
+	uint64_t *buffer, *from = records, *to, counts[8][256] = {{0}}, offset;
+	_Bool skip;
+
+	if(length < 2)
+		return 0;
+
+	if((buffer = (uint64_t *)malloc(length * stride * sizeof(uint64_t))) == NULL) { // Attempt to allocate somewhere to move the records to and from
+		perror("fvmr -> Failure allocating memory for sort");
+
+		return 1;
+	}
+
+	to = buffer;
+
+	for(uint64_t i = 0; i < length; i++) // Count the occurrences of each value of each byte of the keys, all in one go
+		for(uint64_t byte = 0; byte < 8; byte++)
+			counts[byte][(uint8_t)(records[i * stride] >> byte * 8)]++;
+
+	for(uint64_t byte = 0; byte < 8; byte++) { // Then sort by each byte in turn, from the least significant
+		skip = 0;
+
+		for(uint64_t digit = 0, total = 0; digit < 256; digit++) { // Turn the counts into where each digit's records start
+			if(counts[byte][digit] == length) // If every key has the same byte here, the pass wouldn't change anything
+				skip = 1;
+
+			offset = counts[byte][digit];
+			counts[byte][digit] = total;
+			total += offset;
+		}
+
+		if(skip)
+			continue;
+
+		for(uint64_t i = 0; i < length; i++) // Move each record to its place for this byte
+			memcpy(to + counts[byte][(uint8_t)(from[i * stride] >> byte * 8)]++ * stride, from + i * stride, stride * sizeof(uint64_t));
+
+		to = from;
+		from = from == records ? buffer : records;
+	}
+
+	if(from != records) // If the sorted records ended up in the buffer, move them back
+		memcpy(records, from, length * stride * sizeof(uint64_t));
+
+	free(buffer);
+
+	return 0;
+}
+
+uint64_t algorithm_search(const uint64_t *records, uint64_t length, uint64_t stride, uint64_t key) { // Binary search sorted records for one with key as its first word, giving its index, or length if there isn't one
+	uint64_t low = 0, high = length, middle;
+
+	while(low < high) { // Find the first record whose key isn't less than key
+		middle = low + (high - low) / 2;
+
+		if(records[middle * stride] < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low < length && records[low * stride] == key ? low : length;
+}
+
+void algorithm_reverse(uint64_t *records, uint64_t length, uint64_t stride) { // Reverse the order of records
+	uint64_t word;
+
+	for(uint64_t i = 0; i < length / 2; i++) // Swap each record in the first half with its counterpart in the second
+		for(uint64_t j = 0; j < stride; j++) {
+			word = records[i * stride + j];
+			records[i * stride + j] = records[(length - i - 1) * stride + j];
+			records[(length - i - 1) * stride + j] = word;
+		}
+}
+
+uint64_t algorithm_unique(uint64_t *records, uint64_t length, uint64_t stride) { // Remove all but the first of each run of identical records, moving the rest down, and giving how many are left
+	uint64_t kept = length ? 1 : 0;
+
+	for(uint64_t i = 1; i < length; i++)
+		if(memcmp(records + i * stride, records + (kept - 1) * stride, stride * sizeof(uint64_t))) // If it's different to the last one kept, keep it
+			memmove(records + kept++ * stride, records + i * stride, stride * sizeof(uint64_t));
+
+	return kept;
+}
+
+_Bool algorithm_run(uint64_t operation, uint64_t *result) { // Carry out an operation on the records described by the parameters, setting *result
+	uint64_t *records,
+			 length = algorithm_parameters[ALGORITHM_LENGTH],
+			 stride = algorithm_parameters[ALGORITHM_STRIDE];
+
+	if(length > UINT64_MAX / stride) { // If the records couldn't all be addressed
+		fprintf(stderr, "fvmr -> Algorithm coprocessor given %zu records of %zu words, which is out of range\n", length, stride);
+
+		return 1;
+	}
+
+	if(channel_reserve(MEM, algorithm_parameters[ALGORITHM_BASE], length * stride)) // Make sure all of the records are in Main Memory before taking a pointer to them
+		return 1;
+
+	records = channel_pointer(MEM, algorithm_parameters[ALGORITHM_BASE]);
+	*result = length;
+
+	switch(operation) {
+		case ALGORITHM_SORT:
+			return algorithm_sort(records, length, stride);
+		case ALGORITHM_SEARCH:
+			*result = algorithm_search(records, length, stride, algorithm_parameters[ALGORITHM_KEY]);
+
+			return 0;
+		case ALGORITHM_REVERSE:
+			algorithm_reverse(records, length, stride);
+
+			return 0;
+		case ALGORITHM_UNIQUE:
+			*result = algorithm_unique(records, length, stride);
+
+			return 0;
+		default:
+			fprintf(stderr, "fvmr -> Attempted to access unknown address '%zu' on MCH 7\n", operation);
+
+			return 1;
+	}
+}
+
+// Allocator, which hands out blocks of Main Memory above everything else in it. Each block's size is rounded up to a power of two (its size class), and freed blocks are kept in a list for their size class to be handed out again (unless they're at the top of the heap, in which case they're taken off it, along with any freed blocks they were on top of):
+
+enum fvm_allocator_address { // Addresses on the Allocator's channel
+	ALLOCATOR_ALLOCATE = 0, // ld: MDR = address of a new block of MDR words (malloc)
+	ALLOCATOR_FREE = 1, // st: free the block at MDR (free)
+	ALLOCATOR_BLOCK = 2, // st/ld: the address of the block to be reallocated
+	ALLOCATOR_REALLOCATE = 3 // ld: MDR = address of the block, resized to MDR words (realloc)
+};
+
+struct fvm_allocator {
+	uint64_t top, // Address after the last block
+			 block; // Block to be reallocated
+	struct fvm_hash_map classes, // Size class of each allocated block, by address (so that the guest can't corrupt it)
+						free_ends; // Size class of each freed block, by the address just after it (so that the block below the top of the heap can be found)
+	struct fvm_file free_blocks[NO_SIZE_CLASSES]; // Addresses of freed blocks of each size class (only self, size, and length are used)
+} allocator;
+
+uint64_t size_class(uint64_t words) { // The size class that holds blocks of words words (log2 of words, rounded up)
+	return words > 1 ? 64 - __builtin_clzll(words - 1) : 0;
+}
+
+_Bool allocator_allocate(uint64_t words, uint64_t *address) { // Set *address = the address of a new block of at least words words
+	uint64_t class = size_class(words);
+
+	if(class >= NO_SIZE_CLASSES) { // If it's bigger than any block that can be handed out
+		fprintf(stderr, "fvmr -> Attempted to allocate %zu words, which is too many\n", words);
+
+		return 1;
+	}
+
+	if(allocator.free_blocks[class].length) { // If a block of this size has been freed, hand it out again
+		*address = allocator.free_blocks[class].self[--allocator.free_blocks[class].length];
+
+		hash_map_delete(&allocator.free_ends, *address + ((uint64_t)1 << class));
+	} else { // Otherwise, take a new one from the top of the heap
+		if(allocator.top < files[MEM].length) // Which starts above everything in Main Memory (including anything the guest has put there since the last block)
+			allocator.top = files[MEM].length;
+
+		if(channel_reserve(MEM, allocator.top, (uint64_t)1 << class))
+			return 1;
+
+		*address = allocator.top;
+		allocator.top += (uint64_t)1 << class;
+	}
+
+	return hash_map_put(&allocator.classes, *address, class);
+}
+
+void allocator_unlist(uint64_t address, uint64_t class) { // Take the freed block at address out of the list for its size class
+	struct fvm_file *list = &allocator.free_blocks[class];
+
+	for(uint64_t i = list->length; i-- > 0;) { // (Searching from the end, where the most recently freed blocks are)
+		if(list->self[i] == address) {
+			list->self[i] = list->self[--list->length];
+
+			return;
+		}
+	}
+}
+
+_Bool allocator_free(uint64_t address) { // Free the block at address
+	uint64_t class,
+			 end;
+
+	if(!address) // Freeing 0 (which is never handed out) does nothing, so that failed allocations needn't be checked for
+		return 0;
+
+	if(!hash_map_get(&allocator.classes, address, &class)) { // If it isn't a block that's been handed out
+		fprintf(stderr, "fvmr -> Attempted to free address '%zu', which isn't an allocated block\n", address);
+
+		return 1;
+	}
+
+	hash_map_delete(&allocator.classes, address);
+
+	if(address + ((uint64_t)1 << class) == allocator.top) { // If it's the last block, take it off the top of the heap instead
+		end = allocator.top;
+		allocator.top = address;
+
+		while(hash_map_get(&allocator.free_ends, allocator.top, &class)) { // Along with every freed block that's now at the top
+			hash_map_delete(&allocator.free_ends, allocator.top);
+
+			allocator.top -= (uint64_t)1 << class;
+
+			allocator_unlist(allocator.top, class);
+		}
+
+		if(files[MEM].length == end) { // And if that was the end of Main Memory, shrink that too
+			files[MEM].length = allocator.top;
+
+			if(files[MEM].size - files[MEM].length >= ALLOCATOR_TRIM_SIZE && (alloc_buff = (void *)realloc(files[MEM].self, files[MEM].length * sizeof(uint64_t))) != NULL) { // Giving back enough of the memory to the host to be worth it (if that doesn't work, Main Memory just stays the size it was)
+				files[MEM].self = (uint64_t *)alloc_buff;
+				files[MEM].size = files[MEM].length;
+			}
+		}
+
+		return 0;
+	}
+
+	if(allocator.free_blocks[class].length + 1 > allocator.free_blocks[class].size) { // If the list of free blocks needs reallocating to include it
+		allocator.free_blocks[class].size += ALLOC_SIZE;
+
+		if((alloc_buff = (void *)realloc(allocator.free_blocks[class].self, allocator.free_blocks[class].size * sizeof(uint64_t))) == NULL) { // Try to allocate it more space
+			perror("fvmr -> Failure reallocating memory for list of free blocks");
+
+			return 1;
+		}
+
+		allocator.free_blocks[class].self = (uint64_t *)alloc_buff;
+	}
+
+	allocator.free_blocks[class].self[allocator.free_blocks[class].length++] = address; // Keep it to be handed out again
+
+	return hash_map_put(&allocator.free_ends, address + ((uint64_t)1 << class), class);
+}
+
+_Bool allocator_reallocate(uint64_t address, uint64_t words, uint64_t *moved) { // Set *moved = the address of the block at address, resized to words words (moving it if it doesn't fit)
+	uint64_t class;
+
+	if(!address) // Reallocating 0 is just allocating
+		return allocator_allocate(words, moved);
+
+	if(!hash_map_get(&allocator.classes, address, &class)) { // If it isn't a block that's been handed out
+		fprintf(stderr, "fvmr -> Attempted to reallocate address '%zu', which isn't an allocated block\n", address);
+
+		return 1;
+	}
+
+	if(size_class(words) <= class) { // If it already fits, it can stay where it is
+		*moved = address;
+
+		return 0;
+	}
+
+	if(allocator_allocate(words, moved)) // Otherwise, move it to a new block
+		return 1;
+
+	memcpy(files[MEM].self + *moved, files[MEM].self + address, ((uint64_t)1 << class) * sizeof(uint64_t));
+
+	return allocator_free(address);
+}
+
+void allocator_reset(void) { // Forget every block, and free the allocator's memory
+	hash_map_free(&allocator.classes);
+	hash_map_free(&allocator.free_ends);
+
+	for(uint64_t i = 0; i < NO_SIZE_CLASSES; i++)
+		free(allocator.free_blocks[i].self);
+
+	allocator = (struct fvm_allocator){0};
+}
+
+// Devices, handling memory channels (or, for Input and Output, each endpoint on them) through callbacks (struct fvm_device, from fvm_runtime.h), so that embedders can add their own:
+
+_Bool main_memory_write(uint64_t address, uint64_t value) { // MEM
+	if(address >= DISK_WINDOW_BASE) { // If the address is in the disk window, write straight to the disk
+		if(channel_reserve(MEM, address, 1))
+			return 1;
+
+		*channel_pointer(MEM, address) = value;
+
+		return 0;
+	}
+
+	if(address + 1 > files[MEM].length) { // If the address is bigger than what's used
+		files[MEM].length = address + 1;
+
+		if(files[MEM].length > files[MEM].size) { // If it's bigger than what's allocated
+			files[MEM].size = files[MEM].length;
+
+			if((alloc_buff = (void *)realloc(files[MEM].self, files[MEM].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate Main Memory more space to accomodate the write
+				perror("fvmr -> Failure accessing memory at specified address");
+
+				return 1;
+			}
+
+			files[MEM].self = (uint64_t *)alloc_buff;
+		}
+	}
+
+	files[MEM].self[address] = value; // Store value at address in Main Memory
+
+	return 0;
+}
+
+_Bool main_memory_read(uint64_t address, uint64_t *value) { // MEM
+	if(address >= DISK_WINDOW_BASE) { // If the address is in the disk window, read straight from the disk
+		if(channel_reserve(MEM, address, 1))
+			return 1;
+
+		*value = *channel_pointer(MEM, address);
+
+		return 0;
+	}
+
+	if(address + 1 > files[MEM].length) { // If the address to load from is outside the bounds currently allocated
+		files[MEM].length = address + 1; // Resize the memory known
+
+		if(files[MEM].length > files[MEM].size) { // If a reallocation needs to be done in accordance with the new size
+			files[MEM].size = files[MEM].length;
+
+			if((alloc_buff = (void *)realloc(files[MEM].self, files[MEM].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate Main Memory
+				perror("fvmr -> Failure accessing memory at specified address");
+
+				return 1;
+			}
+
+			files[MEM].self = (uint64_t *)alloc_buff;
+		}
+	}
+
+	*value = files[MEM].self[address]; // Place the value from Main Memory at address into *value
+
+	return 0;
+}
+
+_Bool callstack_write(uint64_t address, uint64_t value) { // CST
+	if(address + 1 > files[CST].size) { // If address is an address not currently in the allocated memory's range
+		files[CST].size = address + 1;
+
+		if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate the callstack to accomodate it
+			perror("fvmr -> Failure to reallocate memory for Callstack to perform write to custom address thereupon");
+
+			return 1;
+		}
+
+		files[CST].self = (uint64_t *)alloc_buff;
+	}
+
+	files[CST].self[address] = value; // Write value to address in CST
+
+	return 0;
+}
+
+_Bool callstack_read(uint64_t address, uint64_t *value) { // CST
+	if(address + 1 > files[CST].size) { // If the address to read from is outside of the allocated size for the Callstack
+		files[CST].size = address + 1;
+
+		if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Try to reallocate the Callstack's memory to retrieve the address
+			perror("fvmr -> Failure to reallocate memory for Callstack to perform read from custom address thereupon");
+
+			return 1;
+		}
+
+		files[CST].self = (uint64_t *)alloc_buff;
+	}
+
+	*value = files[CST].self[address]; // Place the value at address on the Callstack into *value
+
+	return 0;
+}
+
+_Bool data_stack_write(uint64_t address, uint64_t value) { // DST
+	if(address + 1 > files[DST].size) { // If address is not currently in the allocated memory's range
+		files[DST].size = address + 1;
+
+		if((alloc_buff = (void *)realloc(files[DST].self, files[DST].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate the Data Stack to accomodate it
+			perror("fvmr -> Failure to reallocate memory for Data Stack to perform write to custom address thereupon");
+
+			return 1;
+		}
+
+		files[DST].self = (uint64_t *)alloc_buff;
+	}
+
+	files[DST].self[address] = value; // Write value to address in DST
+
+	return 0;
+}
+
+_Bool data_stack_read(uint64_t address, uint64_t *value) { // DST
+	if(address + 1 > files[DST].size) { // If the address to read from is outside of the allocated size for the Data Stack
+		files[DST].size = address + 1;
+
+		if((alloc_buff = (void *)realloc(files[DST].self, files[DST].size * sizeof(uint64_t))) == NULL) { // Try to reallocate the Data Stack's memory to retrieve the address
+			perror("fvmr -> Failure to reallocate memory for Data Stack to perform read from custom address thereupon");
+
+			return 1;
+		}
+
+		files[DST].self = (uint64_t *)alloc_buff;
+	}
+
+	*value = files[DST].self[address]; // Place the value at address on the Data Stack into *value
+
+	return 0;
+}
+
+_Bool stdin_write(uint64_t address, uint64_t value) { // INP endpoint 0
+	(void)address;
+
+	fprintf(stdin, "%c", (uint8_t)value); // Write the lowest byte to stdin
+
+	return 0;
+}
+
+_Bool stdin_read(uint64_t address, uint64_t *value) { // INP endpoint 0
+	(void)address;
+
+	*value = input_getc(); // Place a byte from stdin into *value
+
+	return 0;
+}
+
+_Bool stdin_read_block(uint64_t address, uint64_t *values, uint64_t count) { // INP endpoint 0
+	uint8_t *buffer;
+	uint64_t read;
+
+	(void)address;
+
+	if((buffer = (uint8_t *)malloc(count + 1)) == NULL) { // Attempt to allocate a buffer for the bytes to be read
+		perror("fvmr -> Could not allocate memory for block read from stdin");
+
+		return 1;
+	}
+
+	read = input_read_bytes(buffer, count); // Read all of the bytes in one go
+
+	for(uint64_t i = 0; i < count; i++) // Placing each in its own word, with EOF for any that couldn't be read (as reading them one at a time would give)
+		values[i] = i < read ? buffer[i] : (uint64_t)EOF;
+
+	free(buffer);
+
+	return 0;
+}
+
+_Bool disk_offset_write(uint64_t address, uint64_t value) { // INP endpoint 1
+	(void)address;
+
+	disk.offset = value; // Set the offset from the beginning of the disk to value
+
+	return 0;
+}
+
+_Bool disk_offset_read(uint64_t address, uint64_t *value) { // INP endpoint 1
+	(void)address;
+
+	*value = disk.offset; // Set *value to current offset from beginning of disk (in bytes)
+
+	return 0;
+}
+
+_Bool number_input_write(uint64_t address, uint64_t value) { // INP endpoint 2
+	(void)address;
+
+	if(value < 2 || value > MAX_NUMBER_BASE) { // If it's not a base that numbers can be written in
+		fprintf(stderr, "fvmr -> Attempted to set number base to '%zu', but it must be from 2 to %d\n", value, MAX_NUMBER_BASE);
+
+		return 1;
+	}
+
+	number_base = value; // Set the base that numbers are written and read in to value
+
+	return 0;
+}
+
+_Bool number_input_read(uint64_t address, uint64_t *value) { // INP endpoint 2
+	(void)address;
+
+	*value = read_number(); // Read a number in the number base from stdin into *value
+
+	return 0;
+}
+
+_Bool input_control_write(uint64_t address, uint64_t value) { // INP endpoint 5
+	(void)address;
+
+	input.nonblocking = value != 0; // Make reading stdin non-blocking if value isn't 0, or blocking if it is
+
+	return 0;
+}
+
+_Bool input_control_read(uint64_t address, uint64_t *value) { // INP endpoint 5
+	(void)address;
+
+	*value = input.status; // Retrieve what happened the last time stdin or a peripheral was read, or a peripheral written (INPUT_READ, INPUT_END, INPUT_WAITING, or INPUT_INVALID)
+
+	return 0;
+}
+
+_Bool disk_window_write(uint64_t address, uint64_t value) { // INP endpoint 4
+	(void)address;
+
+	if(value) // Map the disk into Main Memory from DISK_WINDOW_BASE
+		return disk_window_map();
+
+	disk_window_unmap(); // Or, if value is 0, unmap it
+
+	return 0;
+}
+
+_Bool disk_window_read(uint64_t address, uint64_t *value) { // INP endpoint 4
+	(void)address;
+
+	*value = disk_window.length; // Retrieve the number of words mapped (0 if it isn't)
+
+	return 0;
+}
+
+_Bool peripheral_control_write(uint64_t address, uint64_t value) { // INP endpoint 6
+	(void)address;
+
+	return peripheral_close(value); // Close the peripheral on endpoint value
+}
+
+_Bool peripheral_control_read(uint64_t address, uint64_t *value) { // INP endpoint 6
+	(void)address;
+
+	return peripheral_open(*value, value); // Open the path stored at *value in Main Memory as a peripheral, retrieving the endpoint it's on (or UINT64_MAX if it couldn't be opened)
+}
+
+_Bool peripheral_wait_write(uint64_t address, uint64_t value) { // INP endpoint 7
+	(void)address;
+
+	peripherals.timeout = value; // Set how many milliseconds waiting gives up after (UINT64_MAX to never give up)
+
+	return 0;
+}
+
+_Bool peripheral_wait_read(uint64_t address, uint64_t *value) { // INP endpoint 7
+	(void)address;
+
+	return peripheral_wait(value); // Wait for a peripheral to have input, retrieving its endpoint (or UINT64_MAX if none did in time)
+}
+
+_Bool peripheral_write(uint64_t address, uint64_t value) { // INP/OUT endpoints from PERIPHERAL_ENDPOINT
+	uint64_t count = 1;
+
+	return peripheral_write_bytes(address, &(uint8_t){value}, &count); // Write the lowest byte to the peripheral, if it can take it without blocking
+}
+
+_Bool peripheral_read(uint64_t address, uint64_t *value) { // INP/OUT endpoints from PERIPHERAL_ENDPOINT
+	uint8_t byte;
+	uint64_t count = 1;
+
+	if(peripheral_read_bytes(address, &byte, &count)) // Read one byte from the peripheral, if one is ready
+		return 1;
+
+	*value = count ? byte : (uint64_t)EOF; // Or EOF if not (with INP endpoint 5 saying why)
+
+	return 0;
+}
+
+_Bool peripheral_write_block(uint64_t address, const uint64_t *values, uint64_t count) { // INP/OUT endpoints from PERIPHERAL_ENDPOINT
+	uint8_t *bytes;
+	_Bool failed;
+
+	if((bytes = (uint8_t *)malloc(count + 1)) == NULL) {
+		perror("fvmr -> Could not allocate memory for block write to peripheral");
+
+		return 1;
+	}
+
+	for(uint64_t i = 0; i < count; i++) // Take the lowest byte of each word
+		bytes[i] = values[i];
+
+	failed = peripheral_write_bytes(address, bytes, &count); // And write as many as it will take in one go
+
+	free(bytes);
+
+	return failed;
+}
+
+_Bool peripheral_read_block(uint64_t address, uint64_t *values, uint64_t count) { // INP/OUT endpoints from PERIPHERAL_ENDPOINT
+	uint8_t *bytes;
+	uint64_t read = count;
+
+	if((bytes = (uint8_t *)malloc(count + 1)) == NULL) {
+		perror("fvmr -> Could not allocate memory for block read from peripheral");
+
+		return 1;
+	}
+
+	if(peripheral_read_bytes(address, bytes, &read)) { // Read as many bytes as are ready in one go
+		free(bytes);
+
+		return 1;
+	}
+
+	for(uint64_t i = 0; i < count; i++) // Each into its own word, with EOF for any that weren't ready
+		values[i] = i < read ? bytes[i] : (uint64_t)EOF;
+
+	free(bytes);
+
+	return 0;
+}
+
+_Bool stdout_write(uint64_t address, uint64_t value) { // OUT endpoint 0
+	(void)address;
+
+	if(capture.self != NULL) { // If it's being captured, keep the whole word
+		capture_word(value);
+
+		return 0;
+	}
+
+	fprintf(stdout, "%c", (uint8_t)value); // Write the lowest byte to stdout
+
+	return 0;
+}
+
+_Bool stdout_read(uint64_t address, uint64_t *value) { // OUT endpoint 0
+	(void)address;
+
+	*value = fgetc(stdout); // Retrieve one byte from stdout into *value
+
+	return 0;
+}
+
+_Bool bytes_write_block(FILE *file, const uint64_t *values, uint64_t count) { // Write the lowest byte of each of count words to file in one go
+	uint8_t *buffer;
+
+	if((buffer = (uint8_t *)malloc(count + 1)) == NULL) { // Attempt to allocate a buffer for the bytes to be written
+		perror("fvmr -> Could not allocate memory for block write");
+
+		return 1;
+	}
+
+	for(uint64_t i = 0; i < count; i++)
+		buffer[i] = (uint8_t)values[i];
+
+	fwrite(buffer, sizeof(uint8_t), count, file);
+
+	free(buffer);
+
+	return 0;
+}
+
+_Bool stdout_write_block(uint64_t address, const uint64_t *values, uint64_t count) { // OUT endpoint 0
+	(void)address;
+
+	if(capture.self != NULL) { // If it's being captured, keep each whole word
+		for(uint64_t i = 0; i < count; i++)
+			capture_word(values[i]);
+
+		return 0;
+	}
+
+	return bytes_write_block(stdout, values, count);
+}
+
+_Bool disk_write(uint64_t address, uint64_t value) { // OUT endpoint 1
+	(void)address;
+
+	return disk_write_bytes(&(uint8_t){value}, 1); // Write the lowest byte to disk
+}
+
+_Bool disk_write_block(uint64_t address, const uint64_t *values, uint64_t count) { // OUT endpoint 1
+	uint8_t bytes[DISK_BLOCK_SIZE];
+	uint64_t n;
+
+	(void)address;
+
+	for(uint64_t i = 0; i < count; i += n) { // Write the lowest byte of each word, a block of them at a time
+		n = count - i < DISK_BLOCK_SIZE ? count - i : DISK_BLOCK_SIZE;
+
+		for(uint64_t j = 0; j < n; j++)
+			bytes[j] = (uint8_t)values[i + j];
+
+		if(disk_write_bytes(bytes, n))
+			return 1;
+	}
+
+	return 0;
+}
+
+_Bool disk_read(uint64_t address, uint64_t *value) { // OUT endpoint 1
+	uint8_t byte;
+	uint64_t count = 1;
+
+	(void)address;
+
+	if(disk_read_bytes(&byte, &count)) // Read one byte from the disk
+		return 1;
+
+	if(count) // Into *value (which stays the same at the end of the disk)
+		*value = byte;
+
+	return 0;
+}
+
+_Bool disk_read_block(uint64_t address, uint64_t *values, uint64_t count) { // OUT endpoint 1
+	uint8_t bytes[DISK_BLOCK_SIZE];
+	uint64_t n;
+
+	(void)address;
+
+	for(uint64_t i = 0; i < count; i += DISK_BLOCK_SIZE) { // Read a block of bytes at a time, each into its own word
+		n = count - i < DISK_BLOCK_SIZE ? count - i : DISK_BLOCK_SIZE;
+
+		if(disk_read_bytes(bytes, &n))
+			return 1;
+
+		for(uint64_t j = 0; j < n; j++)
+			values[i + j] = bytes[j];
+	}
+
+	return 0;
+}
+
+_Bool number_output_write(uint64_t address, uint64_t value) { // OUT endpoint 2
+	(void)address;
+
+	write_number(value); // Write value to stdout as a number in the number base
+
+	return 0;
+}
+
+_Bool number_output_read(uint64_t address, uint64_t *value) { // OUT endpoint 2
+	(void)address;
+
+	*value = number_base; // Retrieve the base that numbers are written and read in
+
+	return 0;
+}
+
+_Bool hash_map_write(uint64_t address, uint64_t value) { // HSH
+	return hash_map_put(&hash_map, address, value); // Set the value of key address to value
+}
+
+_Bool hash_map_read(uint64_t address, uint64_t *value) { // HSH
+	if(!hash_map_get(&hash_map, address, value)) // Place the value of key address into *value
+		*value = 0; // Keys that aren't there read as 0
+
+	return 0;
+}
+
+_Bool hash_control_write(uint64_t address, uint64_t value) { // HSC
+	switch(address) { // Depending on address, do something different to the hash map
+		case 0: // Clear it
+			hash_map_free(&hash_map);
+
+			return 0;
+		case 1: // Delete key value from it
+			hash_map_delete(&hash_map, value);
+
+			return 0;
+		default:
+			fprintf(stderr, "fvmr -> Attempted write to unknown address '%zu' on MCH 6\n", address);
+
+			return 1;
+	}
+}
+
+_Bool hash_control_read(uint64_t address, uint64_t *value) { // HSC
+	switch(address) { // Depending on address, find out something different about the hash map
+		case 0: // Number of keys in it
+			*value = hash_map.length;
+
+			return 0;
+		case 1: // Whether key *value is in it
+			*value = hash_map_get(&hash_map, *value, &(uint64_t){0});
+
+			return 0;
+		default:
+			fprintf(stderr, "fvmr -> Attempted read from unknown address '%zu' on MCH 6\n", address);
+
+			return 1;
+	}
+}
+
+_Bool algorithm_write(uint64_t address, uint64_t value) { // ALG
+	if(address >= ALGORITHM_SORT) // If it's an operation, carry it out
+		return algorithm_run(address, &(uint64_t){0});
+
+	if(address == ALGORITHM_STRIDE && !value) { // Records can't be empty
+		fprintf(stderr, "fvmr -> Attempted to set Algorithm coprocessor's stride to 0\n");
+
+		return 1;
+	}
+
+	algorithm_parameters[address] = value; // Otherwise, set the parameter to value
+
+	return 0;
+}
+
+_Bool algorithm_read(uint64_t address, uint64_t *value) { // ALG
+	if(address >= ALGORITHM_SORT) // If it's an operation, carry it out, placing the result in *value
+		return algorithm_run(address, value);
+
+	*value = algorithm_parameters[address]; // Otherwise, read back the parameter
+
+	return 0;
+}
+
+_Bool allocator_write(uint64_t address, uint64_t value) { // ALC
+	switch(address) {
+		case ALLOCATOR_FREE: // Free the block at value
+			return allocator_free(value);
+		case ALLOCATOR_BLOCK: // Set the block to be reallocated to value
+			allocator.block = value;
+
+			return 0;
+		default:
+			fprintf(stderr, "fvmr -> Attempted write to unknown address '%zu' on MCH 8\n", address);
+
+			return 1;
+	}
+}
+
+_Bool allocator_read(uint64_t address, uint64_t *value) { // ALC
+	switch(address) {
+		case ALLOCATOR_ALLOCATE: // Allocate a block of *value words, placing its address in *value
+			return allocator_allocate(*value, value);
+		case ALLOCATOR_BLOCK: // Retrieve the block to be reallocated
+			*value = allocator.block;
+
+			return 0;
+		case ALLOCATOR_REALLOCATE: // Reallocate the block to *value words, placing its (possibly new) address in *value
+			if(allocator_reallocate(allocator.block, *value, value))
+				return 1;
+
+			allocator.block = *value; // So that it can be reallocated again straight away
+
+			return 0;
+		default:
+			fprintf(stderr, "fvmr -> Attempted read from unknown address '%zu' on MCH 8\n", address);
+
+			return 1;
+	}
+}
+
+#define FVM_CHANNEL_DEVICES(DEVICE) /* Device handling each memory channel, as DEVICE(number, write, read, write_block, read_block) (Input and Output are handled by their endpoints instead) */ \
+	DEVICE(MEM, main_memory_write, main_memory_read, NULL, NULL) \
+	DEVICE(CST, callstack_write, callstack_read, NULL, NULL) \
+	DEVICE(DST, data_stack_write, data_stack_read, NULL, NULL) \
+	DEVICE(HSH, hash_map_write, hash_map_read, NULL, NULL) \
+	DEVICE(HSC, hash_control_write, hash_control_read, NULL, NULL) \
+	DEVICE(ALG, algorithm_write, algorithm_read, NULL, NULL) \
+	DEVICE(ALC, allocator_write, allocator_read, NULL, NULL)
+
+#define FVM_PERIPHERAL_DEVICES(DEVICE) /* Peripherals, on the same endpoints of both Input and Output (one for each of NO_PERIPHERALS, from PERIPHERAL_ENDPOINT) */ \
+	DEVICE(8, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block) \
+	DEVICE(9, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block) \
+	DEVICE(10, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block) \
+	DEVICE(11, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block) \
+	DEVICE(12, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block) \
+	DEVICE(13, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block) \
+	DEVICE(14, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block) \
+	DEVICE(15, peripheral_write, peripheral_read, peripheral_write_block, peripheral_read_block)
+
+#define FVM_INPUT_DEVICES(DEVICE) /* Device handling each endpoint (MAR) on Input (3, the screen buffer, isn't implemented yet) */ \
+	DEVICE(0, stdin_write, stdin_read, NULL, stdin_read_block) \
+	DEVICE(1, disk_offset_write, disk_offset_read, NULL, NULL) \
+	DEVICE(2, number_input_write, number_input_read, NULL, NULL) \
+	DEVICE(4, disk_window_write, disk_window_read, NULL, NULL) \
+	DEVICE(5, input_control_write, input_control_read, NULL, NULL) \
+	DEVICE(6, peripheral_control_write, peripheral_control_read, NULL, NULL) \
+	DEVICE(7, peripheral_wait_write, peripheral_wait_read, NULL, NULL) \
+	FVM_PERIPHERAL_DEVICES(DEVICE)
+
+#define FVM_OUTPUT_DEVICES(DEVICE) /* Device handling each endpoint (MAR) on Output */ \
+	DEVICE(0, stdout_write, stdout_read, stdout_write_block, NULL) \
+	DEVICE(1, disk_write, disk_read, disk_write_block, disk_read_block) \
+	DEVICE(2, number_output_write, number_output_read, NULL, NULL) \
+	FVM_PERIPHERAL_DEVICES(DEVICE)
+
+#define DEVICE_ENTRY(number, write, read, write_block, read_block) [number] = {write, read, write_block, read_block},
+
+struct fvm_device channels[NO_CHANNELS] = {FVM_CHANNEL_DEVICES(DEVICE_ENTRY)},
+				  input_endpoints[NO_ENDPOINTS] = {FVM_INPUT_DEVICES(DEVICE_ENTRY)},
+				  output_endpoints[NO_ENDPOINTS] = {FVM_OUTPUT_DEVICES(DEVICE_ENTRY)};
+
+#ifndef FVM_FIXED_DEVICES // Builds with FVM_FIXED_DEVICES only ever have the devices above, so can't register any others
+_Bool fvmr_register_channel(uint64_t channel, struct fvm_device device) { // Handle a memory channel with device (all NULL to remove it), returning whether that can't be done
+	if(channel >= NO_CHANNELS || channel_stored(channel) || channel == INP || channel == OUT) { // Stored channels are operated on directly by block instructions, and Input and Output are split into endpoints
+		fprintf(stderr, "fvmr -> Attempted to register a device on MCH '%zu', which can't have one\n", channel);
+
+		return 1;
+	}
+
+	channels[channel] = device;
+
+	return 0;
+}
+
+_Bool fvmr_register_endpoint(uint64_t channel, uint64_t endpoint, struct fvm_device device) { // Handle an endpoint on Input or Output with device (all NULL to remove it), returning whether that can't be done
+	if((channel != INP && channel != OUT) || endpoint >= NO_ENDPOINTS) {
+		fprintf(stderr, "fvmr -> Attempted to register a device on endpoint '%zu' of MCH '%zu', which can't have one\n", endpoint, channel);
+
+		return 1;
+	}
+
+	(channel == INP ? input_endpoints : output_endpoints)[endpoint] = device;
+
+	return 0;
+}
+#endif
+
+struct fvm_device *channel_device(uint64_t channel, uint64_t address) { // The device handling address in the memory channel given, or NULL if there isn't one
+	if(channel == INP || channel == OUT)
+		return address < NO_ENDPOINTS ? &(channel == INP ? input_endpoints : output_endpoints)[address] : NULL;
+
+	return channel < NO_CHANNELS ? &channels[channel] : NULL;
+}
+
+#ifdef FVM_FIXED_DEVICES // Dispatch with a switch instead of through the tables, so that each device's callbacks can be inlined into the instructions
+#define DEVICE_WRITE(number, write, read, write_block, read_block) case number: return write(address, value);
+#define DEVICE_READ(number, write, read, write_block, read_block) case number: return read(address, value);
+
+_Bool channel_write(uint64_t channel, uint64_t address, uint64_t value) { // Write value at address in the memory channel given (the common part of all storing instructions)
+	switch(channel) {
+		FVM_CHANNEL_DEVICES(DEVICE_WRITE)
+		case INP:
+			switch(address) {
+				FVM_INPUT_DEVICES(DEVICE_WRITE)
+			}
+
+			break;
+		case OUT:
+			switch(address) {
+				FVM_OUTPUT_DEVICES(DEVICE_WRITE)
+			}
+
+			break;
+		default:
+			fprintf(stderr, "fvmr -> Attempted write to unknown MCH '%zu'\n", channel);
+
+			return 1;
+	}
+
+	fprintf(stderr, "fvmr -> Warning, writing to address on MCH %zu that is currently unimplemented\n", channel); // Endpoints without devices are just ignored
+
+	return 0;
+}
+
+_Bool channel_read(uint64_t channel, uint64_t address, uint64_t *value) { // Read the value at address in the memory channel given into *value (the common part of all loading instructions)
+	switch(channel) {
+		FVM_CHANNEL_DEVICES(DEVICE_READ)
+		case INP:
+			switch(address) {
+				FVM_INPUT_DEVICES(DEVICE_READ)
+			}
+
+			break;
+		case OUT:
+			switch(address) {
+				FVM_OUTPUT_DEVICES(DEVICE_READ)
+			}
+
+			break;
+		default:
+			fprintf(stderr, "fvmr -> Attempted read from unknown MCH '%zu'\n", channel);
+
+			return 1;
+	}
+
+	fprintf(stderr, "fvmr -> Warning, reading from address on MCH %zu that is currently unimplemented\n", channel); // Endpoints without devices are just ignored
+
+	return 0;
+}
+#else
+_Bool channel_write(uint64_t channel, uint64_t address, uint64_t value) { // Write value at address in the memory channel given (the common part of all storing instructions)
+	struct fvm_device *device = channel_device(channel, address);
+
+	if(device != NULL && device->write != NULL)
+		return device->write(address, value);
+
+	if(channel == INP || channel == OUT) { // Endpoints without devices are just ignored
+		fprintf(stderr, "fvmr -> Warning, writing to address on MCH %zu that is currently unimplemented\n", channel);
+
+		return 0;
+	}
+
+	fprintf(stderr, "fvmr -> Attempted write to unknown MCH '%zu'\n", channel);
+
+	return 1;
+}
+
+_Bool channel_read(uint64_t channel, uint64_t address, uint64_t *value) { // Read the value at address in the memory channel given into *value (the common part of all loading instructions)
+	struct fvm_device *device = channel_device(channel, address);
+
+	if(device != NULL && device->read != NULL)
+		return device->read(address, value);
+
+	if(channel == INP || channel == OUT) { // Endpoints without devices are just ignored
+		fprintf(stderr, "fvmr -> Warning, reading from address on MCH %zu that is currently unimplemented\n", channel);
+
+		return 0;
+	}
+
+	fprintf(stderr, "fvmr -> Attempted read from unknown MCH '%zu'\n", channel);
+
+	return 1;
+}
+#endif
+
+_Bool store(void) { // st <mdr> at <mar> in <mch>
+//    printf("store %zu at %zu in %zu\n", fvm_registers[MDR], fvm_registers[MAR], fvm_registers[MCH]);
+
+	return channel_write(fvm_registers[MCH], fvm_registers[MAR], fvm_registers[MDR]);
+}
+
+_Bool load(void) { // ld to <mdr> from <mar> in <mch>
+//    printf("load %zu in %zu\n", fvm_registers[MAR], fvm_registers[MCH]);
+
+	return channel_read(fvm_registers[MCH], fvm_registers[MAR], &fvm_registers[MDR]);
+}
+
+// Register forms of the accumulator instructions, which take the value to operate with from the register given as their operand instead of DAT:
+
+_Bool unknown_register(uint64_t number) { // Report, and return 1 for, a register operand that isn't a known register
+	if(number < NO_REGISTERS)
+		return 0;
+
+	fprintf(stderr, "fvmr -> Attempted to operate with value in unknown register '%zu'\n", number);
+
+	return 1;
+}
+
+_Bool accumulator_add_register(void) { // a+r <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] += fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC += register
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_sub_register(void) { // a-r <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] -= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC -= register
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_mul_register(void) { // a*r <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] *= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC *= register
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_div_register(void) { // a/r <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	if(!fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]) { // If the value to divide by is zero
+		fprintf(stderr, "fvmr -> Attempted to divide by zero\n");
+
+		return 1;
+	}
+
+	fvm_registers[ACC] /= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC /= register
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_and_register(void) { // a&r <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] &= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = Logical AND bits of ACC with register
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_or_register(void) { // a|r <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] |= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = Logical OR bits of ACC with register
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_xor_register(void) { // a^r <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] ^= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = Logical XOR bits of ACC with register
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_lsh_register(void) { // alr <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] <<= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // Left shift bits of ACC by register amount
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_rsh_register(void) { // arr <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] >>= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // Right shift bits of ACC by register amount
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_gt_register(void) { // gtr <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = fvm_registers[ACC] > fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = 1 if ACC > register otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_lt_register(void) { // ltr <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = fvm_registers[ACC] < fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = 1 if ACC < register otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_ge_register(void) { // ger <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = fvm_registers[ACC] >= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = 1 if ACC >= register otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_le_register(void) { // ler <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = fvm_registers[ACC] <= fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = 1 if ACC <= register otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_eq_register(void) { // eqr <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = fvm_registers[ACC] == fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = 1 if ACC == register otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_ne_register(void) { // ner <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = fvm_registers[ACC] != fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // ACC = 1 if ACC != register otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool store_direct(void) { // sta <address>
+	if(channel_write(fvm_registers[MCH], files[MEM].self[fvm_registers[CEA] + 1], fvm_registers[MDR])) // Store MDR at the address given in MCH
+		return 1;
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool load_direct(void) { // lda <address>
+	if(channel_read(fvm_registers[MCH], files[MEM].self[fvm_registers[CEA] + 1], &fvm_registers[MDR])) // Load the value at the address given in MCH into MDR
+		return 1;
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool store_indirect(void) { // str <register>
+	if(files[MEM].self[fvm_registers[CEA] + 1] >= NO_REGISTERS) { // If the register specified is not a known register
+		fprintf(stderr,
+				"fvmr -> Attempted to store at address held in unknown register '%zu'\n",
+				files[MEM].self[fvm_registers[CEA] + 1]);
+
+		return 1;
+	}
+
+	if(channel_write(fvm_registers[MCH], fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]], fvm_registers[MDR])) // Store MDR at the address held in the register given, in MCH
+		return 1;
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool load_indirect(void) { // ldr <register>
+	if(files[MEM].self[fvm_registers[CEA] + 1] >= NO_REGISTERS) { // If the register specified is not a known register
+		fprintf(stderr,
+				"fvmr -> Attempted to load from address held in unknown register '%zu'\n",
+				files[MEM].self[fvm_registers[CEA] + 1]);
+
+		return 1;
+	}
+
+	if(channel_read(fvm_registers[MCH], fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]], &fvm_registers[MDR])) // Load the value at the address held in the register given, in MCH, into MDR
+		return 1;
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool store_indexed(void) { // stx
+	return channel_write(fvm_registers[MCH], fvm_registers[MAR] + fvm_registers[DAT], fvm_registers[MDR]); // Store MDR at MAR + DAT in MCH
+}
+
+_Bool load_indexed(void) { // ldx
+	return channel_read(fvm_registers[MCH], fvm_registers[MAR] + fvm_registers[DAT], &fvm_registers[MDR]); // Load the value at MAR + DAT in MCH into MDR
+}
+
+_Bool jump(void) { // jm <address>
+    fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+
+    return 0;
+}
+
+_Bool jump_if_set(void) { // js <address>
+    if(fvm_registers[ACC]) // If ACC is non-zero:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure to not treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool jump_if_clear(void) { // jc <address>
+    if(!fvm_registers[ACC]) // If ACC is zero:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool jump_if_greater(void) { // jgt <address>
+    if(fvm_registers[ACC] > fvm_registers[DAT]) // If ACC > DAT:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool jump_if_less(void) { // jlt <address>
+    if(fvm_registers[ACC] < fvm_registers[DAT]) // If ACC < DAT:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool jump_if_greater_equal(void) { // jge <address>
+    if(fvm_registers[ACC] >= fvm_registers[DAT]) // If ACC >= DAT:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool jump_if_less_equal(void) { // jle <address>
+    if(fvm_registers[ACC] <= fvm_registers[DAT]) // If ACC <= DAT:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool jump_if_equal(void) { // jeq <address>
+    if(fvm_registers[ACC] == fvm_registers[DAT]) // If ACC == DAT:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool jump_if_not_equal(void) { // jne <address>
+    if(fvm_registers[ACC] != fvm_registers[DAT]) // If ACC != DAT:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = number in front of this one, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA]++; // Otherwise, make sure not to treat the supplied address as an instruction, by skipping over it
+
+    return 0;
+}
+
+_Bool decrement_jump_if_set(void) { // djn <register> <address>
+	if(files[MEM].self[fvm_registers[CEA] + 1] >= NO_REGISTERS) { // If the register specified is not a known register
+		fprintf(stderr,
+				"fvmr -> Attempted to count down unknown register '%zu'\n",
+				files[MEM].self[fvm_registers[CEA] + 1]);
+
+		return 1;
+	}
+
+    if(--fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]) // Decrement the register, and if it's still non-zero:
+        fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 2] - 1; // Set CEA = the address given, take one to combat the increment at the end of each cycle
+    else
+        fvm_registers[CEA] += 2; // Otherwise, skip over both operands
+
+    return 0;
+}
+
+_Bool accumulator_add(void) { // a+
+//    printf("acc += %zu\n", fvm_registers[DAT]);
+
+    fvm_registers[ACC] += fvm_registers[DAT]; // ACC += DAT
+
+    return 0;
+}
+
+_Bool accumulator_sub(void) { // a-
+    fvm_registers[ACC] -= fvm_registers[DAT]; // ACC -= DAT
+
+    return 0;
+}
+
+_Bool accumulator_not(void) { // a!
+    fvm_registers[ACC] = ~fvm_registers[ACC]; // Invert bits of ACC
+
+    return 0;
+}
+
+
+_Bool accumulator_increment(void) { // ai
+    fvm_registers[ACC]++; // ACC += 1
+
+    return 0;
+}
+
+
+_Bool accumulator_decrement(void) { // ad
+    fvm_registers[ACC]--; // ACC -= 1
+
+    return 0;
+}
+
+
+_Bool accumulator_mul(void) { // a*
+    fvm_registers[ACC] *= fvm_registers[DAT]; // ACC *= DAT
+
+    return 0;
+}
+
+
+_Bool accumulator_div(void) { // a/
+    fvm_registers[ACC] /= fvm_registers[DAT]; // ACC /= DAT
+
+    return 0;
+}
+
+
+_Bool accumulator_and(void) { // a&
+    fvm_registers[ACC] &= fvm_registers[DAT]; // ACC = Logical AND bits of ACC with DAT
+
+    return 0;
+}
+
+_Bool accumulator_or(void) { // a|
+    fvm_registers[ACC] |= fvm_registers[DAT]; // ACC = Logical OR bits of ACC with DAT
+
+    return 0;
+}
+
+
+_Bool accumulator_xor(void) { // a^
+    fvm_registers[ACC] ^= fvm_registers[DAT]; // ACC = Logical XOR bits of ACC with DAT
+
+    return 0;
+}
+
+
+_Bool accumulator_lsh(void) { // al
+    fvm_registers[ACC] <<= fvm_registers[DAT]; // Left shift bits of ACC by DAT amount
+
+    return 0;
+}
+
+
+_Bool accumulator_rsh(void) { // ar
+    fvm_registers[ACC] >>= fvm_registers[DAT]; // Right shift bits of ACC by DAT amount
+
+    return 0;
+}
+
+
+_Bool accumulator_gt(void) { // gt
+    fvm_registers[ACC] = fvm_registers[ACC] > fvm_registers[DAT]; // ACC = 1 if ACC > DAT otherwise ACC = 0
+
+    return 0;
+}
+
+
+_Bool accumulator_lt(void) { // lt
+    fvm_registers[ACC] = fvm_registers[ACC] < fvm_registers[DAT]; // ACC = 1 if ACC < DAT otherwise ACC = 0
+
+    return 0;
+}
+
+_Bool accumulator_ge(void) { // ge
+    fvm_registers[ACC] = fvm_registers[ACC] >= fvm_registers[DAT]; // ACC = 1 if ACC >= DAT otherwise ACC = 0
+
+    return 0;
+}
+
+
+_Bool accumulator_le(void) { // le
+    fvm_registers[ACC] = fvm_registers[ACC] <= fvm_registers[DAT]; // ACC = 1 if ACC <= DAT otherwise ACC = 0
+
+    return 0;
+}
+
+_Bool accumulator_eq(void) { // eq
+    fvm_registers[ACC] = fvm_registers[ACC] == fvm_registers[DAT]; // ACC = 1 if ACC == DAT otherwise ACC = 0
+
+    return 0;
+}
+
+
+_Bool accumulator_ne(void) { // ne
+    fvm_registers[ACC] = fvm_registers[ACC] != fvm_registers[DAT]; // ACC = 1 if ACC != DAT otherwise ACC = 0
+
+    return 0;
+}
+
+_Bool accumulator_rem(void) { // a%
+	if(!fvm_registers[DAT]) { // If the value to divide by is zero
+		fprintf(stderr, "fvmr -> Attempted to divide by zero\n");
+
+		return 1;
+	}
+
+	fvm_registers[ACC] %= fvm_registers[DAT]; // ACC = remainder of ACC / DAT
+
+	return 0;
+}
+
+// Signed instructions, which treat ACC and DAT as two's complement:
+
+_Bool signed_div(void) { // s/
+	if(!fvm_registers[DAT]) { // If the value to divide by is zero
+		fprintf(stderr, "fvmr -> Attempted to divide by zero\n");
+
+		return 1;
+	}
+
+	if((int64_t)fvm_registers[DAT] == -1) // Dividing by -1 is negation, which wraps (INT64_MIN / -1 would overflow)
+		fvm_registers[ACC] = -fvm_registers[ACC];
+	else
+		fvm_registers[ACC] = (int64_t)fvm_registers[ACC] / (int64_t)fvm_registers[DAT]; // ACC /= DAT, rounding towards zero
+
+	return 0;
+}
+
+_Bool signed_rem(void) { // s%
+	if(!fvm_registers[DAT]) { // If the value to divide by is zero
+		fprintf(stderr, "fvmr -> Attempted to divide by zero\n");
+
+		return 1;
+	}
+
+	if((int64_t)fvm_registers[DAT] == -1) // Anything divides by -1 exactly (and INT64_MIN % -1 would overflow)
+		fvm_registers[ACC] = 0;
+	else
+		fvm_registers[ACC] = (int64_t)fvm_registers[ACC] % (int64_t)fvm_registers[DAT]; // ACC = remainder of ACC / DAT, taking the sign of ACC
+
+	return 0;
+}
+
+_Bool signed_rsh(void) { // sr
+	fvm_registers[ACC] = (int64_t)fvm_registers[ACC] >> (fvm_registers[DAT] > 63 ? 63 : fvm_registers[DAT]); // Right shift bits of ACC by DAT amount, filling with copies of the sign bit
+
+	return 0;
+}
+
+_Bool signed_gt(void) { // sgt
+	fvm_registers[ACC] = (int64_t)fvm_registers[ACC] > (int64_t)fvm_registers[DAT]; // ACC = 1 if ACC > DAT as signed values otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool signed_lt(void) { // slt
+	fvm_registers[ACC] = (int64_t)fvm_registers[ACC] < (int64_t)fvm_registers[DAT]; // ACC = 1 if ACC < DAT as signed values otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool signed_ge(void) { // sge
+	fvm_registers[ACC] = (int64_t)fvm_registers[ACC] >= (int64_t)fvm_registers[DAT]; // ACC = 1 if ACC >= DAT as signed values otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool signed_le(void) { // sle
+	fvm_registers[ACC] = (int64_t)fvm_registers[ACC] <= (int64_t)fvm_registers[DAT]; // ACC = 1 if ACC <= DAT as signed values otherwise ACC = 0
+
+	return 0;
+}
+
+// Bit-manipulation instructions, which map onto the compiler's builtins (and so single instructions on x86-64 and WASM):
+
+_Bool accumulator_popcount(void) { // pc
+	fvm_registers[ACC] = __builtin_popcountll(fvm_registers[ACC]); // ACC = number of bits set in ACC
+
+	return 0;
+}
+
+_Bool accumulator_leading_zeros(void) { // lz
+	fvm_registers[ACC] = fvm_registers[ACC] ? __builtin_clzll(fvm_registers[ACC]) : 64; // ACC = number of zero bits above the highest set bit of ACC (the builtin is undefined for 0)
+
+	return 0;
+}
+
+_Bool accumulator_trailing_zeros(void) { // tz
+	fvm_registers[ACC] = fvm_registers[ACC] ? __builtin_ctzll(fvm_registers[ACC]) : 64; // ACC = number of zero bits below the lowest set bit of ACC (the builtin is undefined for 0)
+
+	return 0;
+}
+
+_Bool accumulator_rotate_left(void) { // rl
+	fvm_registers[ACC] = fvm_registers[ACC] << (fvm_registers[DAT] & 63) | fvm_registers[ACC] >> (-fvm_registers[DAT] & 63); // Rotate bits of ACC left by DAT amount (compilers recognise this as a rotate instruction)
+
+	return 0;
+}
+
+_Bool accumulator_rotate_right(void) { // rr
+	fvm_registers[ACC] = fvm_registers[ACC] >> (fvm_registers[DAT] & 63) | fvm_registers[ACC] << (-fvm_registers[DAT] & 63); // Rotate bits of ACC right by DAT amount
+
+	return 0;
+}
+
+_Bool accumulator_byte_swap(void) { // bs
+	fvm_registers[ACC] = __builtin_bswap64(fvm_registers[ACC]); // Reverse the order of the bytes of ACC
+
+	return 0;
+}
+
+_Bool accumulator_mul_high(void) { // mh
+#ifdef __SIZEOF_INT128__
+	fvm_registers[ACC] = (unsigned __int128)fvm_registers[ACC] * fvm_registers[DAT] >> 64; // ACC = the upper 64 bits of the 128-bit product of ACC and DAT
+#else
+	uint64_t low = (fvm_registers[ACC] & UINT32_MAX) * (fvm_registers[DAT] & UINT32_MAX), // Otherwise, put it together from 32-bit halves
+			 middle_a = (fvm_registers[ACC] >> 32) * (fvm_registers[DAT] & UINT32_MAX),
+			 middle_b = (fvm_registers[ACC] & UINT32_MAX) * (fvm_registers[DAT] >> 32),
+			 high = (fvm_registers[ACC] >> 32) * (fvm_registers[DAT] >> 32),
+			 carry = ((low >> 32) + (middle_a & UINT32_MAX) + (middle_b & UINT32_MAX)) >> 32;
+
+	fvm_registers[ACC] = high + (middle_a >> 32) + (middle_b >> 32) + carry;
+#endif
+
+	return 0;
+}
+
+// Conditional select instructions, which choose between ACC and DAT using a mask (all ones or all zeros) rather than branching:
+
+uint64_t select_value(_Bool condition, uint64_t a, uint64_t b) { // a if condition otherwise b, without branching
+	uint64_t mask = -(uint64_t)condition;
+
+	return (a & mask) | (b & ~mask);
+}
+
+_Bool select_if_set(void) { // cs <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = select_value(fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]] != 0, fvm_registers[DAT], fvm_registers[ACC]); // ACC = DAT if the register is non-zero, otherwise ACC stays the same
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool select_if_clear(void) { // cz <register>
+	if(unknown_register(files[MEM].self[fvm_registers[CEA] + 1]))
+		return 1;
+
+	fvm_registers[ACC] = select_value(fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]] == 0, fvm_registers[DAT], fvm_registers[ACC]); // ACC = DAT if the register is zero, otherwise ACC stays the same
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_max(void) { // mx
+	fvm_registers[ACC] = select_value(fvm_registers[DAT] > fvm_registers[ACC], fvm_registers[DAT], fvm_registers[ACC]); // ACC = the larger of ACC and DAT
+
+	return 0;
+}
+
+_Bool accumulator_min(void) { // mn
+	fvm_registers[ACC] = select_value(fvm_registers[DAT] < fvm_registers[ACC], fvm_registers[DAT], fvm_registers[ACC]); // ACC = the smaller of ACC and DAT
+
+	return 0;
+}
+
+_Bool signed_max(void) { // smx
+	fvm_registers[ACC] = select_value((int64_t)fvm_registers[DAT] > (int64_t)fvm_registers[ACC], fvm_registers[DAT], fvm_registers[ACC]); // ACC = the larger of ACC and DAT as signed values
+
+	return 0;
+}
+
+_Bool signed_min(void) { // smn
+	fvm_registers[ACC] = select_value((int64_t)fvm_registers[DAT] < (int64_t)fvm_registers[ACC], fvm_registers[DAT], fvm_registers[ACC]); // ACC = the smaller of ACC and DAT as signed values
+
+	return 0;
+}
+
+// Floating-point instructions, which treat the bits of ACC and DAT as IEEE-754 doubles:
+
+double as_double(uint64_t bits) { // The double that a register's bits represent
+	double value;
+
+	memcpy(&value, &bits, sizeof(double));
+
+	return value;
+}
+
+uint64_t as_bits(double value) { // The bits that represent a double, to be put in a register
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(double));
+
+	return bits;
+}
+
+_Bool floating_add(void) { // f+
+	fvm_registers[ACC] = as_bits(as_double(fvm_registers[ACC]) + as_double(fvm_registers[DAT])); // ACC += DAT, as doubles
+
+	return 0;
+}
+
+_Bool floating_sub(void) { // f-
+	fvm_registers[ACC] = as_bits(as_double(fvm_registers[ACC]) - as_double(fvm_registers[DAT])); // ACC -= DAT, as doubles
+
+	return 0;
+}
+
+_Bool floating_mul(void) { // f*
+	fvm_registers[ACC] = as_bits(as_double(fvm_registers[ACC]) * as_double(fvm_registers[DAT])); // ACC *= DAT, as doubles
+
+	return 0;
+}
+
+_Bool floating_div(void) { // f/
+	fvm_registers[ACC] = as_bits(as_double(fvm_registers[ACC]) / as_double(fvm_registers[DAT])); // ACC /= DAT, as doubles
+
+	return 0;
+}
+
+_Bool floating_sqrt(void) { // fsq
+	fvm_registers[ACC] = as_bits(sqrt(as_double(fvm_registers[ACC]))); // ACC = square root of ACC, as a double
+
+	return 0;
+}
+
+_Bool floating_gt(void) { // fgt
+	fvm_registers[ACC] = as_double(fvm_registers[ACC]) > as_double(fvm_registers[DAT]); // ACC = 1 if ACC > DAT as doubles otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool floating_lt(void) { // flt
+	fvm_registers[ACC] = as_double(fvm_registers[ACC]) < as_double(fvm_registers[DAT]); // ACC = 1 if ACC < DAT as doubles otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool floating_ge(void) { // fge
+	fvm_registers[ACC] = as_double(fvm_registers[ACC]) >= as_double(fvm_registers[DAT]); // ACC = 1 if ACC >= DAT as doubles otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool floating_le(void) { // fle
+	fvm_registers[ACC] = as_double(fvm_registers[ACC]) <= as_double(fvm_registers[DAT]); // ACC = 1 if ACC <= DAT as doubles otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool floating_eq(void) { // feq
+	fvm_registers[ACC] = as_double(fvm_registers[ACC]) == as_double(fvm_registers[DAT]); // ACC = 1 if ACC == DAT as doubles otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool floating_ne(void) { // fne
+	fvm_registers[ACC] = as_double(fvm_registers[ACC]) != as_double(fvm_registers[DAT]); // ACC = 1 if ACC != DAT as doubles otherwise ACC = 0
+
+	return 0;
+}
+
+_Bool floating_from_integer(void) { // itf
+	fvm_registers[ACC] = as_bits((double)(int64_t)fvm_registers[ACC]); // ACC = ACC as a double, treating it as a signed (two's complement) integer
+
+	return 0;
+}
+
+_Bool floating_to_integer(void) { // fti
+	double value = as_double(fvm_registers[ACC]);
+
+	if(isnan(value)) // Converting values that don't fit is undefined in C, so NaN gives 0, and everything else saturates
+		fvm_registers[ACC] = 0;
+	else if(value >= 0x1p63)
+		fvm_registers[ACC] = INT64_MAX;
+	else if(value < -0x1p63)
+		fvm_registers[ACC] = (uint64_t)INT64_MIN;
+	else
+		fvm_registers[ACC] = (uint64_t)(int64_t)value; // ACC = ACC as a signed integer, truncated towards zero
+
+	return 0;
+}
+
+// Immediate forms of the accumulator instructions, which take the value to operate with from their operand instead of DAT:
+
+_Bool accumulator_add_immediate(void) { // a+i <value>
+	fvm_registers[ACC] += files[MEM].self[fvm_registers[CEA] + 1]; // ACC += value
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_sub_immediate(void) { // a-i <value>
+	fvm_registers[ACC] -= files[MEM].self[fvm_registers[CEA] + 1]; // ACC -= value
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_mul_immediate(void) { // a*i <value>
+	fvm_registers[ACC] *= files[MEM].self[fvm_registers[CEA] + 1]; // ACC *= value
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_div_immediate(void) { // a/i <value>
+	if(!files[MEM].self[fvm_registers[CEA] + 1]) { // If the value to divide by is zero
+		fprintf(stderr, "fvmr -> Attempted to divide by zero\n");
+
+		return 1;
+	}
+
+	fvm_registers[ACC] /= files[MEM].self[fvm_registers[CEA] + 1]; // ACC /= value
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_and_immediate(void) { // a&i <value>
+	fvm_registers[ACC] &= files[MEM].self[fvm_registers[CEA] + 1]; // ACC = Logical AND bits of ACC with value
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_or_immediate(void) { // a|i <value>
+	fvm_registers[ACC] |= files[MEM].self[fvm_registers[CEA] + 1]; // ACC = Logical OR bits of ACC with value
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_xor_immediate(void) { // a^i <value>
+	fvm_registers[ACC] ^= files[MEM].self[fvm_registers[CEA] + 1]; // ACC = Logical XOR bits of ACC with value
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_lsh_immediate(void) { // ali <value>
+	fvm_registers[ACC] <<= files[MEM].self[fvm_registers[CEA] + 1]; // Left shift bits of ACC by value amount
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_rsh_immediate(void) { // ari <value>
+	fvm_registers[ACC] >>= files[MEM].self[fvm_registers[CEA] + 1]; // Right shift bits of ACC by value amount
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_gt_immediate(void) { // gti <value>
+	fvm_registers[ACC] = fvm_registers[ACC] > files[MEM].self[fvm_registers[CEA] + 1]; // ACC = 1 if ACC > value otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_lt_immediate(void) { // lti <value>
+	fvm_registers[ACC] = fvm_registers[ACC] < files[MEM].self[fvm_registers[CEA] + 1]; // ACC = 1 if ACC < value otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_ge_immediate(void) { // gei <value>
+	fvm_registers[ACC] = fvm_registers[ACC] >= files[MEM].self[fvm_registers[CEA] + 1]; // ACC = 1 if ACC >= value otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_le_immediate(void) { // lei <value>
+	fvm_registers[ACC] = fvm_registers[ACC] <= files[MEM].self[fvm_registers[CEA] + 1]; // ACC = 1 if ACC <= value otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_eq_immediate(void) { // eqi <value>
+	fvm_registers[ACC] = fvm_registers[ACC] == files[MEM].self[fvm_registers[CEA] + 1]; // ACC = 1 if ACC == value otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool accumulator_ne_immediate(void) { // nei <value>
+	fvm_registers[ACC] = fvm_registers[ACC] != files[MEM].self[fvm_registers[CEA] + 1]; // ACC = 1 if ACC != value otherwise ACC = 0
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool call_address(void) { // cl
+    if(++files[CST].length > files[CST].size) { // If the callstack needs reallocating to include the address of this call
+        files[CST].size += ALLOC_SIZE;
+
+        if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Try to allocate it more space
+            perror("fvmr -> Failure reallocating memory for Callstack");
+
+            return 1;
+        }
+
+        files[CST].self = (uint64_t *)alloc_buff;
+    }
+
+    fvm_registers[CSP] = files[CST].length - 1; // Set CSP to new value
+
+    files[CST].self[fvm_registers[CSP]] = fvm_registers[CEA]; // Push CEA onto the Callstack
+    fvm_registers[CEA] = files[MEM].self[fvm_registers[CEA] + 1] - 1; // Set CEA = the address being called upon, take one to combat the increment of CEA each cycle
+
+    return 0;
+}
+
+_Bool return_address(void) { // rt
+    if(!(fvm_registers[CSP] + 1)) { // If there is nothing to pop from the Callstack
+        fprintf(stderr, "fvmr -> Callstack underflow");
+
+        return 1;
+    }
+
+    // Otherwise:
+
+    files[CST].length = fvm_registers[CSP]; // Reassign the length of the callstack to the value of CSP before decrementing CSP
+    fvm_registers[CEA] = files[CST].self[fvm_registers[CSP]--] + 1; // CEA = pop(CST), plus 1 to not try to run the operand of the call as an instruction after return
+
+    return 0;
+}
+
+// Block operations:
+
+_Bool block_copy(void) { // bc <channel>
+	uint64_t value, channel = files[MEM].self[fvm_registers[CEA] + 1];
+	struct fvm_device *source = channel_device(fvm_registers[MCH], fvm_registers[MAR]), *destination = channel_device(channel, fvm_registers[DAT]);
+
+	if(channel_stored(fvm_registers[MCH]) && channel_stored(channel)) { // If both channels are stored, copy the block in one go
+		if(channel_reserve(fvm_registers[MCH], fvm_registers[MAR], fvm_registers[ACC]) || channel_reserve(channel, fvm_registers[DAT], fvm_registers[ACC]))
+			return 1;
+
+		memmove(channel_pointer(channel, fvm_registers[DAT]), channel_pointer(fvm_registers[MCH], fvm_registers[MAR]), fvm_registers[ACC] * sizeof(uint64_t)); // Copy ACC words from MAR in MCH to DAT in the channel given
+	} else if(channel_stored(fvm_registers[MCH]) && destination != NULL && destination->write_block != NULL) { // If only the source is stored, and the device can take a block in one go, give it one
+		if(channel_reserve(fvm_registers[MCH], fvm_registers[MAR], fvm_registers[ACC]) || destination->write_block(fvm_registers[DAT], channel_pointer(fvm_registers[MCH], fvm_registers[MAR]), fvm_registers[ACC]))
+			return 1;
+	} else if(channel_stored(channel) && source != NULL && source->read_block != NULL) { // Likewise, if only the destination is stored, and the device can give a block in one go
+		if(channel_reserve(channel, fvm_registers[DAT], fvm_registers[ACC]) || source->read_block(fvm_registers[MAR], channel_pointer(channel, fvm_registers[DAT]), fvm_registers[ACC]))
+			return 1;
+	} else { // Otherwise, go word-by-word, streaming to/from the same address of any channel that's a device
+		for(uint64_t i = 0; i < fvm_registers[ACC]; i++) {
+			value = fvm_registers[MDR]; // Each word is read as ld would, with MDR given to devices that take a value in (such as a path, or a size to allocate)
+
+			if(channel_read(fvm_registers[MCH], fvm_registers[MAR] + (channel_stored(fvm_registers[MCH]) ? i : 0), &value) || channel_write(channel, fvm_registers[DAT] + (channel_stored(channel) ? i : 0), value))
+				return 1;
+		}
+	}
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool block_fill(void) { // bf
+	uint64_t *block;
+
+	if(!channel_stored(fvm_registers[MCH])) { // If the channel is a device, write MDR to it ACC times
+		for(uint64_t i = 0; i < fvm_registers[ACC]; i++)
+			if(channel_write(fvm_registers[MCH], fvm_registers[MAR], fvm_registers[MDR]))
+				return 1;
+
+		return 0;
+	}
+
+	if(channel_reserve(fvm_registers[MCH], fvm_registers[MAR], fvm_registers[ACC]))
+		return 1;
+
+	block = channel_pointer(fvm_registers[MCH], fvm_registers[MAR]);
+
+	if(!fvm_registers[MDR]) { // Clearing a block can be done bytewise
+		memset(block, 0, fvm_registers[ACC] * sizeof(uint64_t));
+
+		return 0;
+	}
+
+	for(uint64_t *word = block; word < block + fvm_registers[ACC]; word++) // Fill ACC words from MAR in MCH with MDR
+		*word = fvm_registers[MDR];
+
+	return 0;
+}
+
+// Direct Memory Access, moving blocks between Main Memory and I/O endpoints with a single read/write of the host:
+
+_Bool dma_read(uint64_t endpoint, uint8_t *bytes, uint64_t *count) { // Read up to *count bytes from an I/O endpoint (as numbered by MAR on MCH 1 and 2), setting *count = the number actually read
+	switch(endpoint) {
+		case 0: // For Standard I/O
+			*count = input_read_bytes(bytes, *count);
+
+			return 0;
+		case 1: // For disk (at its current offset)
+			return disk_read_bytes(bytes, count);
+		default:
+			fprintf(stderr, "fvmr -> Attempted DMA with endpoint '%zu' that doesn't support it\n", endpoint);
+
+			return 1;
+	}
+}
+
+_Bool dma_write(uint64_t endpoint, const uint8_t *bytes, uint64_t *count) { // Write *count bytes to an I/O endpoint, setting *count = the number actually written
+	switch(endpoint) {
+		case 0: // For Standard I/O
+			*count = stdout_write_bytes(bytes, *count);
+
+			return 0;
+		case 1: // For disk (at its current offset)
+			return disk_write_bytes(bytes, *count);
+		default:
+			fprintf(stderr, "fvmr -> Attempted DMA with endpoint '%zu' that doesn't support it\n", endpoint);
+
+			return 1;
+	}
+}
+
+_Bool dma_in(void) { // di <endpoint>
+	uint8_t *buffer;
+	uint64_t *words;
+
+	if(channel_reserve(MEM, fvm_registers[MAR], fvm_registers[ACC])) // Make sure the whole destination is in Main Memory
+		return 1;
+
+	words = channel_pointer(MEM, fvm_registers[MAR]);
+
+	if((buffer = (uint8_t *)malloc(fvm_registers[ACC] + 1)) == NULL) { // Attempt to allocate a buffer for the bytes to be read
+		perror("fvmr -> Could not allocate memory for DMA");
+
+		return 1;
+	}
+
+	if(dma_read(files[MEM].self[fvm_registers[CEA] + 1], buffer, &fvm_registers[ACC])) { // Read up to ACC bytes in one go, leaving ACC = the number actually read
+		free(buffer);
+
+		return 1;
+	}
+
+	for(uint64_t i = 0; i < fvm_registers[ACC]; i++) // Place each byte in its own word from MAR in Main Memory
+		words[i] = buffer[i];
+
+	free(buffer);
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool dma_out(void) { // do <endpoint>
+	uint8_t *buffer;
+	uint64_t *words;
+
+	if(channel_reserve(MEM, fvm_registers[MAR], fvm_registers[ACC])) // Make sure the whole source is in Main Memory
+		return 1;
+
+	words = channel_pointer(MEM, fvm_registers[MAR]);
+
+	if((buffer = (uint8_t *)malloc(fvm_registers[ACC] + 1)) == NULL) { // Attempt to allocate a buffer for the bytes to be written
+		perror("fvmr -> Could not allocate memory for DMA");
+
+		return 1;
+	}
+
+	for(uint64_t i = 0; i < fvm_registers[ACC]; i++) // Take the lowest byte of each word from MAR in Main Memory
+		buffer[i] = (uint8_t)words[i];
+
+	if(dma_write(files[MEM].self[fvm_registers[CEA] + 1], buffer, &fvm_registers[ACC])) { // Write them in one go, leaving ACC = the number actually written
+		free(buffer);
+
+		return 1;
+	}
+
+	free(buffer);
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+// Vector instructions, operating on ranges of Main Memory:
+
+VECTOR_KERNEL(vector_kernel_add, x + y)
+VECTOR_KERNEL(vector_kernel_sub, x - y)
+VECTOR_KERNEL(vector_kernel_mul, x * y)
+VECTOR_KERNEL(vector_kernel_and, x & y)
+VECTOR_KERNEL(vector_kernel_or, x | y)
+VECTOR_KERNEL(vector_kernel_xor, x ^ y)
+VECTOR_KERNEL(vector_kernel_eq, (x == y) & 1) // Comparisons of vectors give -1 for true, so & 1 makes them match the scalar comparisons
+VECTOR_KERNEL(vector_kernel_lt, (x < y) & 1)
+VECTOR_KERNEL(vector_kernel_gt, (x > y) & 1)
+
+_Bool vector_overlaps(uint64_t source) { // Whether the ACC words from source overlap those from MDR without being exactly the same words (which the kernels would otherwise read after overwriting, a chunk at a time)
+	return source != fvm_registers[MDR] && source < fvm_registers[MDR] + fvm_registers[ACC] && fvm_registers[MDR] < source + fvm_registers[ACC];
+}
+
+_Bool vector_apply(void (*kernel)(uint64_t *, const uint64_t *, const uint64_t *, uint64_t)) { // Apply a kernel to the ACC words from MAR and DAT in Main Memory, placing the results from MDR in Main Memory
+	uint64_t *a, *b, *copy = NULL;
+
+	if(channel_reserve(MEM, fvm_registers[MAR], fvm_registers[ACC]) || channel_reserve(MEM, fvm_registers[DAT], fvm_registers[ACC]) || channel_reserve(MEM, fvm_registers[MDR], fvm_registers[ACC])) // Make sure all three ranges are in Main Memory before taking pointers to them
+		return 1;
+
+	a = channel_pointer(MEM, fvm_registers[MAR]);
+	b = channel_pointer(MEM, fvm_registers[DAT]);
+
+	if(vector_overlaps(fvm_registers[MAR]) || vector_overlaps(fvm_registers[DAT])) { // If the results would overwrite a source before it's been read, work from a copy of both sources instead, so that they're always as they were beforehand
+		if((copy = (uint64_t *)malloc(fvm_registers[ACC] * 2 * sizeof(uint64_t))) == NULL) {
+			perror("fvmr -> Could not allocate memory for overlapping vectors");
+
+			return 1;
+		}
+
+		a = memcpy(copy, a, fvm_registers[ACC] * sizeof(uint64_t));
+		b = memcpy(copy + fvm_registers[ACC], b, fvm_registers[ACC] * sizeof(uint64_t));
+	}
+
+	kernel(channel_pointer(MEM, fvm_registers[MDR]), a, b, fvm_registers[ACC]);
+
+	free(copy);
+
+	return 0;
+}
+
+_Bool vector_add(void) { // v+
+	return vector_apply(&vector_kernel_add); // MEM[MDR + i] = MEM[MAR + i] + MEM[DAT + i] for i < ACC
+}
+
+_Bool vector_sub(void) { // v-
+	return vector_apply(&vector_kernel_sub); // MEM[MDR + i] = MEM[MAR + i] - MEM[DAT + i] for i < ACC
+}
+
+_Bool vector_mul(void) { // v*
+	return vector_apply(&vector_kernel_mul); // MEM[MDR + i] = MEM[MAR + i] * MEM[DAT + i] for i < ACC
+}
+
+_Bool vector_and(void) { // v&
+	return vector_apply(&vector_kernel_and); // MEM[MDR + i] = MEM[MAR + i] & MEM[DAT + i] for i < ACC
+}
+
+_Bool vector_or(void) { // v|
+	return vector_apply(&vector_kernel_or); // MEM[MDR + i] = MEM[MAR + i] | MEM[DAT + i] for i < ACC
+}
+
+_Bool vector_xor(void) { // v^
+	return vector_apply(&vector_kernel_xor); // MEM[MDR + i] = MEM[MAR + i] ^ MEM[DAT + i] for i < ACC
+}
+
+_Bool vector_eq(void) { // ve
+	return vector_apply(&vector_kernel_eq); // MEM[MDR + i] = 1 if MEM[MAR + i] == MEM[DAT + i] otherwise 0, for i < ACC
+}
+
+_Bool vector_lt(void) { // v<
+	return vector_apply(&vector_kernel_lt); // MEM[MDR + i] = 1 if MEM[MAR + i] < MEM[DAT + i] otherwise 0, for i < ACC
+}
+
+_Bool vector_gt(void) { // v>
+	return vector_apply(&vector_kernel_gt); // MEM[MDR + i] = 1 if MEM[MAR + i] > MEM[DAT + i] otherwise 0, for i < ACC
+}
+
+_Bool vector_sum(void) { // vs
+	uint64_t *a, n = fvm_registers[ACC], i = 0, sum = 0;
+
+	if(channel_reserve(MEM, fvm_registers[MAR], n))
+		return 1;
+
+	a = channel_pointer(MEM, fvm_registers[MAR]);
+
+#ifdef __GNUC__
+	fvm_vector x, sums = {0};
+
+	for(; i + VECTOR_LANES <= n; i += VECTOR_LANES) { // Add up each lane separately
+		memcpy(&x, a + i, sizeof(fvm_vector));
+
+		sums += x;
+	}
+
+	for(uint64_t j = 0; j < VECTOR_LANES; j++) // Then add the lanes together
+		sum += sums[j];
+#endif
+
+	for(; i < n; i++) // Along with any words left over
+		sum += a[i];
+
+	fvm_registers[ACC] = sum; // ACC = the sum of the ACC words from MAR in Main Memory
+
+	return 0;
+}
+
+_Bool vector_extreme(_Bool maximum) { // Set ACC = the minimum or maximum of the ACC words from MAR in Main Memory (or the identity for that if there are none)
+	uint64_t *a, n = fvm_registers[ACC], i = 0, extreme = maximum ? 0 : UINT64_MAX;
+
+	if(channel_reserve(MEM, fvm_registers[MAR], n))
+		return 1;
+
+	a = channel_pointer(MEM, fvm_registers[MAR]);
+
+#ifdef __GNUC__
+	fvm_vector x, mask, extremes = (fvm_vector){0} + extreme;
+
+	for(; i + VECTOR_LANES <= n; i += VECTOR_LANES) { // Find the extreme of each lane separately, selecting with a mask rather than branching
+		memcpy(&x, a + i, sizeof(fvm_vector));
+
+		mask = (fvm_vector)(maximum ? x > extremes : x < extremes);
+		extremes = (x & mask) | (extremes & ~mask);
+	}
+
+	for(uint64_t j = 0; j < VECTOR_LANES; j++) // Then find the extreme of the lanes
+		if(maximum ? extremes[j] > extreme : extremes[j] < extreme)
+			extreme = extremes[j];
+#endif
+
+	for(; i < n; i++) // Along with any words left over
+		if(maximum ? a[i] > extreme : a[i] < extreme)
+			extreme = a[i];
+
+	fvm_registers[ACC] = extreme;
+
+	return 0;
+}
+
+_Bool vector_min(void) { // vn
+	return vector_extreme(0);
+}
+
+_Bool vector_max(void) { // vx
+	return vector_extreme(1);
+}
+
+// String instructions, searching and comparing ranges of Main Memory:
+
+uint64_t vector_find(const uint64_t *a, uint64_t n, uint64_t key, uint64_t mask) { // Find the index of the first of the n words from a that (once ANDed with mask) is key, or n if there isn't one
+	uint64_t i = 0;
+
+#ifdef __GNUC__
+	fvm_vector x, found;
+	uint64_t any;
+
+	for(; i + VECTOR_LANES <= n; i += VECTOR_LANES) { // Skip over whole vectors that don't contain key
+		memcpy(&x, a + i, sizeof(fvm_vector));
+
+		found = (fvm_vector)((x & mask) == key);
+		any = 0;
+
+		for(uint64_t j = 0; j < VECTOR_LANES; j++)
+			any |= found[j];
+
+		if(any) // The scalar loop will find exactly where it is
+			break;
+	}
+#endif
+
+	for(; i < n; i++)
+		if((a[i] & mask) == key)
+			break;
+
+	return i;
+}
+
+uint64_t vector_mismatch(const uint64_t *a, const uint64_t *b, uint64_t n) { // Find the index of the first of the n words from a and b that differs between them, or n if they're all the same
+	uint64_t i = 0;
+
+#ifdef __GNUC__
+	fvm_vector x, y, differs;
+	uint64_t any;
+
+	for(; i + VECTOR_LANES <= n; i += VECTOR_LANES) { // Skip over whole vectors that are the same
+		memcpy(&x, a + i, sizeof(fvm_vector));
+		memcpy(&y, b + i, sizeof(fvm_vector));
+
+		differs = (fvm_vector)(x != y);
+		any = 0;
+
+		for(uint64_t j = 0; j < VECTOR_LANES; j++)
+			any |= differs[j];
+
+		if(any) // The scalar loop will find exactly where
+			break;
+	}
+#endif
+
+	for(; i < n; i++)
+		if(a[i] != b[i])
+			break;
+
+	return i;
+}
+
+_Bool find_word(void) { // fw
+	uint64_t n = main_memory_extent(fvm_registers[MAR], fvm_registers[ACC]), i; // Only words that are in Main Memory are looked through (so searching never grows it, or looks at what hasn't been written)
+
+	if(n && (i = vector_find(channel_pointer(MEM, fvm_registers[MAR]), n, fvm_registers[DAT], UINT64_MAX)) < n)
+		fvm_registers[ACC] = i; // ACC = index of the first of the ACC words from MAR in Main Memory that is DAT, otherwise ACC stays the same
+
+	return 0;
+}
+
+_Bool find_byte(void) { // fb
+	uint64_t n = main_memory_extent(fvm_registers[MAR], fvm_registers[ACC]), i;
+
+	if(n && (i = vector_find(channel_pointer(MEM, fvm_registers[MAR]), n, (uint8_t)fvm_registers[DAT], UINT8_MAX)) < n)
+		fvm_registers[ACC] = i; // ACC = index of the first of the ACC words from MAR in Main Memory whose lowest byte is the lowest byte of DAT (a character, as written by st to output), otherwise ACC stays the same
+
+	return 0;
+}
+
+_Bool compare_range(void) { // cr
+	uint64_t a = main_memory_extent(fvm_registers[MAR], fvm_registers[ACC]), b = main_memory_extent(fvm_registers[DAT], fvm_registers[ACC]), n = a < b ? a : b; // Only words in Main Memory are compared, with the first that's past the end of it in either range counting as differing
+
+	if(n)
+		n = vector_mismatch(channel_pointer(MEM, fvm_registers[MAR]), channel_pointer(MEM, fvm_registers[DAT]), n);
+
+	if(n < fvm_registers[ACC])
+		fvm_registers[ACC] = n; // ACC = index of the first word that differs between the ACC words from MAR and DAT in Main Memory, otherwise ACC stays the same
+
+	return 0;
+}
+
+_Bool push(void) { // pu <register>
+	if(files[MEM].self[fvm_registers[CEA] + 1] >= NO_REGISTERS) { // If the register specified is not a known register
+		fprintf(stderr,
+				"fvmr -> Attempted to push value in unknown register '%zu' onto the Data Stack\n",
+				files[MEM].self[fvm_registers[CEA] + 1]);
+
+		return 1;
+	}
+
+	if(fvm_registers[DSP] + 1 > files[DST].size) { // If the Data Stack needs reallocating to include the value
+		files[DST].size = fvm_registers[DSP] + DATA_STACK_SIZE;
+
+		if((alloc_buff = (void *)realloc(files[DST].self, files[DST].size * sizeof(uint64_t))) == NULL) { // Try to allocate it more space
+			perror("fvmr -> Failure reallocating memory for Data Stack");
+
+			return 1;
+		}
+
+		files[DST].self = (uint64_t *)alloc_buff;
+	}
+
+	files[DST].self[fvm_registers[DSP]++] = fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]]; // Push the register's value onto the Data Stack
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool pop(void) { // po <register>
+	if(files[MEM].self[fvm_registers[CEA] + 1] >= NO_REGISTERS) { // If the register specified is not a known register
+		fprintf(stderr,
+				"fvmr -> Attempted to pop value from the Data Stack into unknown register '%zu'\n",
+				files[MEM].self[fvm_registers[CEA] + 1]);
+
+		return 1;
+	}
+
+	if(!fvm_registers[DSP] || fvm_registers[DSP] > files[DST].size) { // If there is nothing to pop from the Data Stack
+		fprintf(stderr, "fvmr -> Data Stack underflow\n");
+
+		return 1;
+	}
+
+	fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]] = files[DST].self[--fvm_registers[DSP]]; // register = pop(DST)
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool peek(void) { // pk <register>
+	if(files[MEM].self[fvm_registers[CEA] + 1] >= NO_REGISTERS) { // If the register specified is not a known register
+		fprintf(stderr,
+				"fvmr -> Attempted to peek at the Data Stack into unknown register '%zu'\n",
+				files[MEM].self[fvm_registers[CEA] + 1]);
+
+		return 1;
+	}
+
+	if(!fvm_registers[DSP] || fvm_registers[DSP] > files[DST].size) { // If there is nothing on the Data Stack
+		fprintf(stderr, "fvmr -> Attempted to peek at empty Data Stack\n");
+
+		return 1;
+	}
+
+	fvm_registers[files[MEM].self[fvm_registers[CEA] + 1]] = files[DST].self[fvm_registers[DSP] - 1]; // register = top of DST
+
+	fvm_registers[CEA]++; // Skip over the operand
+
+	return 0;
+}
+
+_Bool (*instructions[NO_INSTRUCTIONS])(void) = { // Array of function-pointers for each instruction
+	[0] = &place,
+	[1] = &move,
+	[2] = &store,
+	[3] = &load,
+	[4] = &jump,
+	[5] = &jump_if_set,
+	[6] = &jump_if_clear,
+	[7] = &accumulator_add,
+	[8] = &accumulator_sub,
+	[9] = &accumulator_not,
+	[10] = &accumulator_increment,
+	[11] = &accumulator_decrement,
+	[12] = &accumulator_mul,
+	[13] = &accumulator_div,
+	[14] = &accumulator_and,
+	[15] = &accumulator_or,
+	[16] = &accumulator_xor,
+	[17] = &accumulator_lsh,
+	[18] = &accumulator_rsh,
+	[19] = &accumulator_gt,
+	[20] = &accumulator_lt,
+	[21] = &accumulator_ge,
+	[22] = &accumulator_le,
+	[23] = &accumulator_eq,
+	[24] = &accumulator_ne,
+	[25] = &call_address,
+	[26] = &return_address,
+
+	// [27] (fi) is handled by the execution loop
+
+	[28] = &accumulator_add_immediate,
+	[29] = &accumulator_sub_immediate,
+	[30] = &accumulator_mul_immediate,
+	[31] = &accumulator_div_immediate,
+	[32] = &accumulator_and_immediate,
+	[33] = &accumulator_or_immediate,
+	[34] = &accumulator_xor_immediate,
+	[35] = &accumulator_lsh_immediate,
+	[36] = &accumulator_rsh_immediate,
+	[37] = &accumulator_gt_immediate,
+	[38] = &accumulator_lt_immediate,
+	[39] = &accumulator_ge_immediate,
+	[40] = &accumulator_le_immediate,
+	[41] = &accumulator_eq_immediate,
+	[42] = &accumulator_ne_immediate,
+
+	[43] = &store_direct,
+	[44] = &load_direct,
+	[45] = &store_indirect,
+	[46] = &load_indirect,
+	[47] = &store_indexed,
+	[48] = &load_indexed,
+
+	[49] = &jump_if_greater,
+	[50] = &jump_if_less,
+	[51] = &jump_if_greater_equal,
+	[52] = &jump_if_less_equal,
+	[53] = &jump_if_equal,
+	[54] = &jump_if_not_equal,
+	[55] = &decrement_jump_if_set,
+
+	[56] = &push,
+	[57] = &pop,
+	[58] = &peek,
+
+	[59] = &accumulator_add_register,
+	[60] = &accumulator_sub_register,
+	[61] = &accumulator_mul_register,
+	[62] = &accumulator_div_register,
+	[63] = &accumulator_and_register,
+	[64] = &accumulator_or_register,
+	[65] = &accumulator_xor_register,
+	[66] = &accumulator_lsh_register,
+	[67] = &accumulator_rsh_register,
+	[68] = &accumulator_gt_register,
+	[69] = &accumulator_lt_register,
+	[70] = &accumulator_ge_register,
+	[71] = &accumulator_le_register,
+	[72] = &accumulator_eq_register,
+	[73] = &accumulator_ne_register,
+
+	[74] = &block_copy,
+	[75] = &block_fill,
+
+	[76] = &dma_in,
+	[77] = &dma_out,
+
+	[78] = &vector_add,
+	[79] = &vector_sub,
+	[80] = &vector_mul,
+	[81] = &vector_and,
+	[82] = &vector_or,
+	[83] = &vector_xor,
+	[84] = &vector_eq,
+	[85] = &vector_lt,
+	[86] = &vector_gt,
+	[87] = &vector_sum,
+	[88] = &vector_min,
+	[89] = &vector_max,
+
+	[90] = &find_word,
+	[91] = &find_byte,
+	[92] = &compare_range,
+
+	[93] = &floating_add,
+	[94] = &floating_sub,
+	[95] = &floating_mul,
+	[96] = &floating_div,
+	[97] = &floating_sqrt,
+	[98] = &floating_gt,
+	[99] = &floating_lt,
+	[100] = &floating_ge,
+	[101] = &floating_le,
+	[102] = &floating_eq,
+	[103] = &floating_ne,
+	[104] = &floating_from_integer,
+	[105] = &floating_to_integer,
+
+	[106] = &accumulator_rem,
+	[107] = &signed_div,
+	[108] = &signed_rem,
+	[109] = &signed_rsh,
+	[110] = &signed_gt,
+	[111] = &signed_lt,
+	[112] = &signed_ge,
+	[113] = &signed_le,
+
+	[114] = &accumulator_popcount,
+	[115] = &accumulator_leading_zeros,
+	[116] = &accumulator_trailing_zeros,
+	[117] = &accumulator_rotate_left,
+	[118] = &accumulator_rotate_right,
+	[119] = &accumulator_byte_swap,
+	[120] = &accumulator_mul_high,
+
+	[121] = &select_if_set,
+	[122] = &select_if_clear,
+	[123] = &accumulator_max,
+	[124] = &accumulator_min,
+	[125] = &signed_max,
+	[126] = &signed_min
+};
+
+int fvmr_execute(const uint64_t *rom, uint64_t length, uint64_t entry, struct fvm_file *memory) { // Run the length words of rom (loaded as Main Memory) from entry, giving Main Memory as it is at the end to memory if it isn't NULL
+	int status = 0;
+
+	memset(fvm_registers, 0, sizeof(fvm_registers)); // Every run starts with clear registers (and so an empty Data Stack), whatever the last one left in them
+	number_base = 10; // Numbers are in decimal until the program says otherwise
+
+	memset(algorithm_parameters, 0, sizeof(algorithm_parameters)); // The Algorithm coprocessor starts off with an empty range of single words
+	algorithm_parameters[ALGORITHM_STRIDE] = 1;
+
+	files[CST] = files[DST] = files[MEM] = (struct fvm_file){0}; // (So that whatever doesn't get set up below can still be cleaned up)
+
+	// Set up (stopping at the first thing that can't be, and going straight to cleaning up):
+
+	if(entry >= length) { // There has to be at least an instruction to run
+		fprintf(stderr, "fvmr -> Entry point '%zu' is outside of ROM of %zu words\n", entry, length);
+
+		status = 2;
+	} else if((files[CST] = (struct fvm_file){.self = calloc(ALLOC_SIZE, sizeof(uint64_t)), .size = ALLOC_SIZE, .length = 0}).self == NULL) { // Try to initialise Callstack
+		perror("fvmr -> Could not allocate memory for Callstack");
+
+		status = 3;
+	} else if((files[DST] = (struct fvm_file){.self = calloc(DATA_STACK_SIZE, sizeof(uint64_t)), .size = DATA_STACK_SIZE, .length = 0}).self == NULL) { // Try to initialise Data Stack
+		perror("fvmr -> Could not allocate memory for Data Stack");
+
+		status = 3;
+	} else if((files[MEM].self = malloc(length * sizeof(uint64_t))) == NULL) { // Attempt to allocate space for Main Memory to contain ROM
+		perror("fvmr -> Could not allocate memory for Main Memory");
+
+		status = 3;
+	} else if(input_open()) { // Try to set up input (Secondary Storage is opened when it's first used)
+		status = 2;
+	} else {
+		memcpy(files[MEM].self, rom, length * sizeof(uint64_t)); // Load ROM into Main Memory
+
+		files[MEM].size = files[MEM].length = length;
+	}
+
+    // Begin execution:
+
+	for(fvm_registers[CEA] = entry; !status && files[MEM].self[fvm_registers[CEA]] != 27; fvm_registers[CEA]++) { // Traverse instructions until instruction 27 (fi - finish) is encountered
+		if(files[MEM].self[fvm_registers[CEA]] >= NO_INSTRUCTIONS) { // If a number is encountered that should be an instruction but isn't in the instructions list
+			fprintf(stderr, "fvmr -> Encountered unknown instruction '%zu'\n", files[MEM].self[fvm_registers[CEA]]);
+
+			traceback();
+
+			status = 4;
+
+			break;
+		}
+
+        if(instructions[files[MEM].self[fvm_registers[CEA]]]()) { // Otherwise, try to execute the current instruction. If it returns a failed status, exit safely
+			traceback();
+
+			status = 4;
+
+			break;
+		}
+	}
+
+    // Cleanup:
+
+    free(files[CST].self);
+    free(files[DST].self);
+    hash_map_free(&hash_map);
+    allocator_reset();
+    disk_window_unmap();
+
+    if(memory != NULL && !status) // Main Memory is handed over if it's wanted
+        *memory = files[MEM];
+    else
+        free(files[MEM].self);
+
+    disk_close();
+    input_close();
+    peripherals_close();
+
+	return status; // Done!
+}
+
+uint64_t *load_rom(const char *path, uint64_t *length) { // Read the ROM file at path into a new buffer, setting *length = the number of words in it (or return NULL if it can't be)
+	FILE *f;
+	struct stat info;
+	uint64_t *rom;
+
+	if((f = fopen(path, "rb")) == NULL) { // Try to open ROM file
+		perror("fvmr -> Could not access ROM");
+
+		return NULL;
+	}
+
+	if(fstat(fileno(f), &info)) { // Get size of ROM
+		perror("fvmr -> Could not get size of ROM");
+
+		fclose(f);
+
+		return NULL;
+	}
+
+	*length = ((uint64_t)info.st_size + sizeof(uint64_t) - 1) / sizeof(uint64_t); // Number of words in it (with any part of a word at the end padded with zeros)
+
+	if((rom = calloc(*length ? *length : 1, sizeof(uint64_t))) == NULL) { // Attempt to allocate space for the ROM
+		perror("fvmr -> Could not allocate memory for ROM");
+
+		fclose(f);
+
+		return NULL;
+	}
+
+	if(fread(rom, 1, info.st_size, f) != (size_t)info.st_size) { // Read in ROM
+		perror("fvmr -> Could not read ROM");
+
+		free(rom);
+		fclose(f);
+
+		return NULL;
+	}
+
+	fclose(f); // Close ROM
+
+	return rom;
+}
+
+int fvmr_run(void) { // Entry point:
+	uint64_t *rom, length;
+	int status;
+
+	if((rom = load_rom(FVM_ROM, &length)) == NULL)
+		return 2;
+
+	status = fvmr_execute(rom, length, 0, NULL);
+
+	free(rom);
+
+	return status;
+}
+
+int fvmr_evaluate_file(const char *path, const char *source, const char *header, const char *name) { // Run the ROM file at path (assembled from source, which is named in the header as what it was generated from) ahead of time, writing Main Memory as it is at the end to header as a C array called name (so that whatever it generates can be compiled into a host program, rather than worked out when that runs)
+	FILE *f;
+	uint64_t *rom, length;
+	struct fvm_file memory;
+	int status;
+
+	if((rom = load_rom(path, &length)) == NULL)
+		return 2;
+
+	status = fvmr_execute(rom, length, 0, &memory);
+
+	free(rom);
+
+	if(status)
+		return status;
+
+	if((f = fopen(header, "w")) == NULL) { // Try to open the header to be written
+		perror("fvmr -> Could not open header for evaluated ROM");
+
+		free(memory.self);
+
+		return 2;
+	}
+
+	fprintf(f, "/* Main Memory of %s after running it, as evaluated by fvmr */\n\n#include <stdint.h>\n\nstatic const uint64_t %s[%" PRIu64 "] = {", source, name, memory.length);
+
+	for(uint64_t i = 0; i < memory.length; i++) // Four words to a line
+		fprintf(f, "%s0x%016" PRIx64, i % 4 ? ", " : (i ? ",\n\t" : "\n\t"), memory.self[i]);
+
+	fprintf(f, "\n};\n");
+
+	fclose(f);
+	free(memory.self);
+
+	return 0;
+}
+
+int fvmr_evaluate(const char *header, const char *name) { // Evaluate the ROM file into header (for the Emscripten build, which only ever has the one ROM)
+	return fvmr_evaluate_file(FVM_ROM, FVM_ROM, header, name);
+}
+
+int fvmr_evaluate_routine(const uint64_t *rom, uint64_t length, uint64_t entry, uint64_t *words, uint64_t count, uint64_t *produced) { // Run the length words of rom from entry, placing the first count words that it writes to stdout in words instead, and setting *produced = how many it wrote (used by fvma to evaluate routines as it assembles them)
+	int status;
+
+	capture = (struct fvm_file){.self = words, .size = count, .length = 0};
+
+	status = fvmr_execute(rom, length, entry, NULL);
 
-    fclose(disk);
+	*produced = capture.length;
+	capture = (struct fvm_file){0};
 
-	return 0; // Done!
+	return status;
 }
@@ -0,0 +1,58 @@
+/* Fox Virtual Machine: Runtime (interface for programs that embed it)
+ * Copyright (C) 2024 Finn Chipp
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FVM_RUNTIME_H
+#define FVM_RUNTIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus // So that C++ programs can embed it too
+extern "C" {
+#endif
+
+struct fvm_file { // A stored memory channel (or any other buffer of words)
+	uint64_t *self, // The words
+			 size, // Number of words allocated
+			 length; // Number of words used
+};
+
+struct fvm_device { // Callbacks handling a memory channel, or an endpoint on Input or Output, each returning whether it failed (which stops the program with a traceback)
+	bool (*write)(uint64_t address, uint64_t value); // Write value at address (NULL if it can't be written)
+	bool (*read)(uint64_t address, uint64_t *value); // Read the value at address into *value (NULL if it can't be read)
+	bool (*write_block)(uint64_t address, const uint64_t *values, uint64_t count); // Write count words to address in one go, as if by write (NULL to write them one at a time)
+	bool (*read_block)(uint64_t address, uint64_t *values, uint64_t count); // Read count words from address in one go, as if by read (NULL to read them one at a time)
+};
+
+int fvmr_run(void); // Run the ROM file, returning 0 if it finished, or the reason it couldn't (2 for files, 3 for memory, 4 for the program failing)
+int fvmr_execute(const uint64_t *rom, uint64_t length, uint64_t entry, struct fvm_file *memory); // Run the length words of rom from entry, giving Main Memory as it is at the end to memory (to be freed by the caller) if it isn't NULL
+int fvmr_evaluate(const char *header, const char *name); // Run the ROM file ahead of time, writing Main Memory as it is at the end to header as a C array called name
+int fvmr_evaluate_file(const char *path, const char *source, const char *header, const char *name); // The same, for the ROM file at path, assembled from source (which the header names as where it came from)
+int fvmr_evaluate_routine(const uint64_t *rom, uint64_t length, uint64_t entry, uint64_t *words, uint64_t count, uint64_t *produced); // Run rom from entry, placing the first count words it writes to stdout in words, and setting *produced = how many it wrote
+void fvmr_input_file(const char *path); // Have runs take their input from the file at path instead of stdin (or from stdin again if path is NULL)
+uint64_t fvmr_attach_peripheral(int fd); // Let the next run use fd as a peripheral (closing it when it finishes), returning the endpoint it's on (or UINT64_MAX if it can't be)
+
+#ifndef FVM_FIXED_DEVICES // Builds with FVM_FIXED_DEVICES only ever have the built-in devices
+bool fvmr_register_channel(uint64_t channel, struct fvm_device device); // Handle a memory channel (9 to 15 are free) with device (all NULL to remove it), returning whether that can't be done
+bool fvmr_register_endpoint(uint64_t channel, uint64_t endpoint, struct fvm_device device); // Handle an endpoint (0 to 15) of Input (1) or Output (2) with device, returning whether that can't be done
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,172 @@
+/* Fox Virtual Machine: Peripheral tests
+ * Copyright (C) 2024 Finn Chipp
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Runs the routines in peripheral_test.fa against local socketpairs and pipes (built and run natively with `make test`,
+ * from the directory with hardware/ in it), returning 0 if everything behaves.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "fvm_runtime.h"
+
+#define TEST_SOURCE "tests/peripheral_test.fa"
+#define TEST_BINARY "tests/peripheral_test.fb"
+#define ECHO_ENTRY 0 // Entry points of the routines in TEST_SOURCE
+#define BROKEN_ENTRY 2
+
+int fvma_main(int argc, char **argv); // From the assembler
+
+int failures = 0; // Number of checks that have failed
+
+void check(_Bool passed, const char *what) { // Report whether what passed
+	printf("%s: %s\n", passed ? "ok" : "FAIL", what);
+
+	failures += !passed;
+}
+
+uint64_t *assemble(uint64_t *length) { // Assemble TEST_SOURCE, setting *length = the number of words in it (or return NULL if it can't be)
+	FILE *f;
+	uint64_t *rom;
+
+	remove(TEST_BINARY);
+
+	fvma_main(3, (char *[]){"fvma", TEST_SOURCE, TEST_BINARY});
+
+	if((f = fopen(TEST_BINARY, "rb")) == NULL) {
+		perror("peripheral_test -> Could not assemble " TEST_SOURCE);
+
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+
+	*length = ftell(f) / sizeof(uint64_t);
+
+	rewind(f);
+
+	if((rom = (uint64_t *)malloc(*length * sizeof(uint64_t))) != NULL && fread(rom, sizeof(uint64_t), *length, f) != *length) {
+		free(rom);
+
+		rom = NULL;
+	}
+
+	fclose(f);
+	remove(TEST_BINARY);
+
+	return rom;
+}
+
+void read_all(int fd, char *text, size_t size) { // Read from fd until it ends, into text (as a string of up to size - 1 characters)
+	size_t length = 0;
+	ssize_t n;
+
+	while(length < size - 1 && (n = read(fd, text + length, size - 1 - length)) > 0)
+		length += n;
+
+	text[length] = '\0';
+}
+
+void test_echo(const uint64_t *rom, uint64_t length) { // Two socketpairs, with input waiting on both, are each echoed back through the one wait loop
+	int a[2], b[2];
+	char text[64];
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, a) || socketpair(AF_UNIX, SOCK_STREAM, 0, b)) {
+		perror("peripheral_test -> Could not create socketpairs");
+
+		failures++;
+
+		return;
+	}
+
+	check(fvmr_attach_peripheral(a[0]) == 8 && fvmr_attach_peripheral(b[0]) == 9, "socketpairs are attached on endpoints 8 and 9");
+
+	write(a[1], "first socket", 12);
+	write(b[1], "second", 6);
+	shutdown(a[1], SHUT_WR); // So that the routine sees each one end, and closes it
+	shutdown(b[1], SHUT_WR);
+
+	check(fvmr_execute(rom, length, ECHO_ENTRY, NULL) == 0, "echo routine finishes");
+
+	read_all(a[1], text, sizeof(text));
+	check(!strcmp(text, "first socket"), "first socketpair is echoed");
+
+	read_all(b[1], text, sizeof(text));
+	check(!strcmp(text, "second"), "second socketpair is echoed");
+
+	close(a[1]);
+	close(b[1]);
+}
+
+void test_broken_pipe(const uint64_t *rom, uint64_t length) { // Writing to a pipe whose reader has gone gives the end status, rather than SIGPIPE killing the test
+	int p[2];
+	uint64_t status = UINT64_MAX, produced;
+
+	if(pipe(p)) {
+		perror("peripheral_test -> Could not create pipe");
+
+		failures++;
+
+		return;
+	}
+
+	close(p[0]);
+
+	check(fvmr_attach_peripheral(p[1]) == 8, "pipe is attached on endpoint 8");
+	check(fvmr_evaluate_routine(rom, length, BROKEN_ENTRY, &status, 1, &produced) == 0 && produced == 1, "broken pipe routine finishes");
+	check(status == 1, "writing to a broken pipe gives the end status");
+}
+
+void test_failed_run(void) { // A run that can't start still closes what was attached for it
+	int p[2];
+
+	if(pipe(p)) {
+		perror("peripheral_test -> Could not create pipe");
+
+		failures++;
+
+		return;
+	}
+
+	fvmr_attach_peripheral(p[0]);
+
+	check(fvmr_execute((uint64_t[]){27}, 1, 1, NULL) == 2, "run with entry point outside of ROM fails");
+	check(fcntl(p[0], F_GETFD) < 0, "peripheral attached for the failed run is closed");
+
+	close(p[1]);
+}
+
+int main(void) {
+	uint64_t *rom, length;
+
+	if((rom = assemble(&length)) == NULL)
+		return 1;
+
+	test_echo(rom, length);
+	test_broken_pipe(rom, length);
+	test_failed_run();
+
+	free(rom);
+
+	printf("%d failed\n", failures);
+
+	return failures != 0;
+}